@@ -3,12 +3,25 @@
 #include "third-party/nhl.h"
 
 #define SRCS\
-  "src/main.c"
+  "src/main.c",\
+  "src/data_source.c",\
+  "src/block_cache.c",\
+  "src/prefetch.c",\
+  "src/type.c",\
+  "src/gather.c",\
+  "src/column_cache.c",\
+  "src/thread_pool.c",\
+  "src/stats.c",\
+  "src/varint.c",\
+  "src/layout.c",\
+  "src/search.c",\
+  "src/signature.c",\
+  "src/byte_regex.c"
 
 #define PREVIEW_TGT "./preview.so"
 #define SHARED_FLAGS "-shared", "-fPIC"
 #define CFLAGS "-ggdb", "-O0"
-#define LDFLAGS "-I./third-party", "-lraylib"
+#define LDFLAGS "-I./third-party", "-lraylib", "-lpthread", "-lm"
 
 bool build_preview(void* ctx){
   
@@ -0,0 +1,196 @@
+#include "nob.h"
+
+#include <unistd.h>
+#include <errno.h>
+
+#include "block_cache.h"
+
+#define TABLE_EMPTY UINT32_MAX
+
+static size_t BlockCache_hash(BlockCache* self, size_t index){
+  // fibonacci hashing, table_capacity is a power of two
+  return (index*11400714819323198485llu) & (self->table_capacity-1);
+}
+
+static uint32_t* BlockCache_find(BlockCache* self, size_t index){
+  size_t i = BlockCache_hash(self, index);
+  while(self->table[i] != TABLE_EMPTY){
+    if(self->blocks[self->table[i]].index == index) return &self->table[i];
+    i = (i+1) & (self->table_capacity-1);
+  }
+  return &self->table[i];
+}
+
+static void BlockCache_unlink(BlockCache* self, size_t index){
+  uint32_t* slot = BlockCache_find(self, index);
+  if(*slot == TABLE_EMPTY) return;
+
+  // backward shift deletion keeps probe sequences intact without tombstones
+  size_t mask = self->table_capacity-1;
+  size_t hole = slot - self->table;
+  size_t i = hole;
+  for(;;){
+    i = (i+1) & mask;
+    if(self->table[i] == TABLE_EMPTY) break;
+    size_t home = BlockCache_hash(self, self->blocks[self->table[i]].index);
+    if(((i-home) & mask) >= ((i-hole) & mask)){
+      self->table[hole] = self->table[i];
+      hole = i;
+    }
+  }
+  self->table[hole] = TABLE_EMPTY;
+}
+
+bool BlockCache_init(BlockCache* self, int fd, size_t file_size, size_t memory_budget){
+  *self = (BlockCache){
+    .fd = fd,
+    .file_size = file_size,
+    .pinned = SIZE_MAX,
+  };
+
+  size_t file_blocks = (file_size + BLOCK_CACHE_BLOCK_SIZE-1)/BLOCK_CACHE_BLOCK_SIZE;
+  self->count = memory_budget/BLOCK_CACHE_BLOCK_SIZE;
+  if(self->count < BLOCK_CACHE_MIN_BLOCKS) self->count = BLOCK_CACHE_MIN_BLOCKS;
+  if(self->count > file_blocks) self->count = file_blocks;
+
+  self->table_capacity = 1;
+  while(self->table_capacity < self->count*2) self->table_capacity *= 2;
+
+  self->blocks = calloc(self->count, sizeof(*self->blocks));
+  self->table = malloc(self->table_capacity*sizeof(*self->table));
+  if(self->blocks == NULL || self->table == NULL){
+    nob_log(NOB_ERROR, "BlockCache_init: could not allocate %zu blocks", self->count);
+    BlockCache_free(self);
+    return false;
+  }
+  memset(self->table, 0xFF, self->table_capacity*sizeof(*self->table));
+  pthread_mutex_init(&self->lock, NULL);
+  for(size_t i = 0; i < self->count; ++i){
+    self->blocks[i].index = SIZE_MAX;
+  }
+
+  nob_log(NOB_INFO, "BlockCache_init: %zu blocks of %d bytes",
+      self->count, BLOCK_CACHE_BLOCK_SIZE);
+  return true;
+}
+
+void BlockCache_free(BlockCache* self){
+  if(self->blocks != NULL){
+    for(size_t i = 0; i < self->count; ++i){
+      free(self->blocks[i].items);
+    }
+    pthread_mutex_destroy(&self->lock);
+  }
+  free(self->blocks);
+  free(self->table);
+  *self = (BlockCache){0};
+}
+
+static size_t BlockCache_evict(BlockCache* self){
+  for(;;){
+    CacheBlock* block = &self->blocks[self->hand];
+    size_t slot = self->hand;
+    self->hand = (self->hand+1) % self->count;
+    if(slot == self->pinned) continue;
+    if(block->referenced){
+      block->referenced = false;
+      continue;
+    }
+    if(block->index != SIZE_MAX) BlockCache_unlink(self, block->index);
+    block->index = SIZE_MAX;
+    return slot;
+  }
+}
+
+static size_t BlockCache_read_block(int fd, uint8_t* items, size_t index, size_t file_size){
+  size_t offset = index*BLOCK_CACHE_BLOCK_SIZE;
+  size_t size = file_size - offset;
+  if(size > BLOCK_CACHE_BLOCK_SIZE) size = BLOCK_CACHE_BLOCK_SIZE;
+
+  size_t done = 0;
+  while(done < size){
+    ssize_t n = pread(fd, items+done, size-done, offset+done);
+    if(n < 0 && errno == EINTR) continue;
+    if(n <= 0){
+      nob_log(NOB_ERROR, "BlockCache_read_block: read failed at %zu: %s",
+          offset+done, n < 0 ? strerror(errno) : "unexpected end of file");
+      return 0;
+    }
+    done += n;
+  }
+  return size;
+}
+
+CacheBlock* BlockCache_get(BlockCache* self, size_t offset){
+  if(offset >= self->file_size) return NULL;
+  size_t index = offset/BLOCK_CACHE_BLOCK_SIZE;
+
+  pthread_mutex_lock(&self->lock);
+  CacheBlock* result = NULL;
+  uint32_t* slot = BlockCache_find(self, index);
+  if(*slot != TABLE_EMPTY){
+    self->hits++;
+    self->pinned = *slot;
+    self->blocks[*slot].referenced = true;
+    nob_return_defer(&self->blocks[*slot]);
+  }
+
+  self->misses++;
+  size_t victim = BlockCache_evict(self);
+  CacheBlock* block = &self->blocks[victim];
+  if(block->items == NULL) block->items = malloc(BLOCK_CACHE_BLOCK_SIZE);
+  if(block->items == NULL) nob_return_defer(NULL);
+  block->size = BlockCache_read_block(self->fd, block->items, index, self->file_size);
+  if(block->size == 0) nob_return_defer(NULL);
+  block->index = index;
+  block->referenced = true;
+  self->pinned = victim;
+  // the eviction may have shifted entries around, look the slot up again
+  *BlockCache_find(self, index) = victim;
+  result = block;
+
+defer:
+  pthread_mutex_unlock(&self->lock);
+  return result;
+}
+
+bool BlockCache_contains(BlockCache* self, size_t offset){
+  if(offset >= self->file_size) return false;
+  pthread_mutex_lock(&self->lock);
+  bool result = *BlockCache_find(self, offset/BLOCK_CACHE_BLOCK_SIZE) != TABLE_EMPTY;
+  pthread_mutex_unlock(&self->lock);
+  return result;
+}
+
+bool BlockCache_prefetch(BlockCache* self, size_t offset){
+  if(offset >= self->file_size) return false;
+  if(BlockCache_contains(self, offset)) return true;
+  size_t index = offset/BLOCK_CACHE_BLOCK_SIZE;
+
+  uint8_t* items = malloc(BLOCK_CACHE_BLOCK_SIZE);
+  if(items == NULL) return false;
+  size_t size = BlockCache_read_block(self->fd, items, index, self->file_size);
+  if(size == 0){
+    free(items);
+    return false;
+  }
+
+  pthread_mutex_lock(&self->lock);
+  // the reader may have loaded it in the meantime
+  if(*BlockCache_find(self, index) == TABLE_EMPTY){
+    size_t victim = BlockCache_evict(self);
+    CacheBlock* block = &self->blocks[victim];
+    uint8_t* old_items = block->items;
+    block->items = items;
+    block->size = size;
+    block->index = index;
+    // prefetched blocks have not been looked at yet, they get no second chance
+    block->referenced = false;
+    *BlockCache_find(self, index) = victim;
+    items = old_items;
+  }
+  pthread_mutex_unlock(&self->lock);
+
+  free(items);
+  return true;
+}
@@ -0,0 +1,56 @@
+#ifndef BLOCK_CACHE_H_
+#define BLOCK_CACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#ifndef BLOCK_CACHE_BLOCK_SIZE
+#define BLOCK_CACHE_BLOCK_SIZE (64*1024)
+#endif // BLOCK_CACHE_BLOCK_SIZE
+
+#define BLOCK_CACHE_MIN_BLOCKS 8
+
+typedef struct{
+  size_t index;     // block index within the file, SIZE_MAX when unused
+  size_t size;      // valid bytes, only the last block of a file is short
+  bool referenced;  // CLOCK second chance bit
+  uint8_t* items;
+} CacheBlock;
+
+// fixed budget cache of file blocks with CLOCK eviction, used when the file
+// is too large to simply be mapped. BlockCache_get is meant for a single
+// reader (the render thread), BlockCache_prefetch may be called from others
+typedef struct{
+  pthread_mutex_t lock;
+  int fd;
+  size_t file_size;
+
+  CacheBlock* blocks;
+  size_t count;
+  size_t hand;
+  size_t pinned; // slot last handed out by BlockCache_get, never evicted
+
+  // open addressing map from block index to slot in blocks
+  uint32_t* table;
+  size_t table_capacity;
+
+  size_t hits;
+  size_t misses;
+} BlockCache;
+
+bool BlockCache_init(BlockCache* self, int fd, size_t file_size, size_t memory_budget);
+void BlockCache_free(BlockCache* self);
+
+// returns the cached block containing offset, reading it from disk on a miss,
+// the block stays valid until the next call into the cache
+CacheBlock* BlockCache_get(BlockCache* self, size_t offset);
+
+bool BlockCache_contains(BlockCache* self, size_t offset);
+
+// reads the block containing offset into the cache unless it is already
+// there, the read itself happens without holding the cache lock
+bool BlockCache_prefetch(BlockCache* self, size_t offset);
+
+#endif // BLOCK_CACHE_H_
@@ -0,0 +1,758 @@
+#include "nob.h"
+
+#include <ctype.h>
+
+#include "byte_regex.h"
+
+#define REGEX_UNBOUNDED SIZE_MAX
+// largest count of a {n,m}
+#define REGEX_MAX_COUNT 1024
+#define REGEX_MAX_NFA_STATES (64*1024)
+
+typedef enum{
+  RegexNode_EMPTY,
+  RegexNode_SET,
+  RegexNode_CONCAT,
+  RegexNode_ALTERNATE,
+  RegexNode_REPEAT,
+} RegexNodeKind;
+
+typedef struct{
+  RegexNodeKind kind;
+  uint8_t set[32]; // bytes a SET matches, as bits
+  size_t left;
+  size_t right;
+  size_t min;
+  size_t max;
+} RegexNode;
+
+typedef struct{
+  RegexNode* items;
+  size_t count;
+  size_t capacity;
+} RegexNodes;
+
+typedef struct{
+  const char* at;
+  RegexNodes nodes;
+  const char* error; // set once parsing failed
+} RegexParser;
+
+static int hex_digit(char c){
+  if(c >= '0' && c <= '9') return c - '0';
+  if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static bool RegexNode_has(RegexNode* self, uint8_t byte){
+  return self->set[byte/8] & (1 << byte%8);
+}
+
+static void RegexNode_add(RegexNode* self, uint8_t byte){
+  self->set[byte/8] |= 1 << byte%8;
+}
+
+static size_t RegexParser_fail(RegexParser* self, const char* error){
+  if(self->error == NULL) self->error = error;
+  return 0;
+}
+
+static size_t RegexParser_node(RegexParser* self, RegexNode node){
+  nob_da_append(&self->nodes, node);
+  return self->nodes.count-1;
+}
+
+// left may be SIZE_MAX for nothing so far
+static size_t RegexParser_concat(RegexParser* self, size_t left, size_t right){
+  if(left == SIZE_MAX) return right;
+  return RegexParser_node(self, (RegexNode){ .kind = RegexNode_CONCAT, .left = left, .right = right });
+}
+
+static void RegexParser_skip(RegexParser* self){
+  while(isspace((unsigned char)*self->at)) self->at++;
+}
+
+static bool RegexParser_byte(RegexParser* self, uint8_t* byte){
+  int high = hex_digit(self->at[0]);
+  int low = high < 0 ? -1 : hex_digit(self->at[1]);
+  if(low < 0) return false;
+  *byte = high*16 + low;
+  self->at += 2;
+  return true;
+}
+
+static bool RegexParser_count(RegexParser* self, size_t* count){
+  if(!isdigit((unsigned char)*self->at)) return false;
+  char* end;
+  unsigned long value = strtoul(self->at, &end, 10);
+  self->at = end;
+  *count = value > REGEX_MAX_COUNT ? REGEX_MAX_COUNT+1 : value;
+  return true;
+}
+
+static size_t RegexParser_alternation(RegexParser* self);
+
+static size_t RegexParser_class(RegexParser* self){
+  RegexNode node = { .kind = RegexNode_SET };
+  self->at++;
+  bool negate = *self->at == '^';
+  if(negate) self->at++;
+  for(;;){
+    RegexParser_skip(self);
+    if(*self->at == ']') break;
+    if(*self->at == '\0') return RegexParser_fail(self, "missing ]");
+    uint8_t low, high;
+    if(!RegexParser_byte(self, &low)) return RegexParser_fail(self, "expected hex byte in class");
+    high = low;
+    RegexParser_skip(self);
+    if(*self->at == '-'){
+      self->at++;
+      RegexParser_skip(self);
+      if(!RegexParser_byte(self, &high)) return RegexParser_fail(self, "expected hex byte in class");
+      if(high < low) return RegexParser_fail(self, "range out of order");
+    }
+    for(size_t byte = low; byte <= high; ++byte) RegexNode_add(&node, byte);
+  }
+  self->at++;
+  if(negate){
+    for(size_t i = 0; i < sizeof(node.set); ++i) node.set[i] = ~node.set[i];
+  }
+  return RegexParser_node(self, node);
+}
+
+static size_t RegexParser_atom(RegexParser* self){
+  RegexNode node = { .kind = RegexNode_SET };
+  switch(*self->at){
+    case '(':{
+      self->at++;
+      size_t inner = RegexParser_alternation(self);
+      RegexParser_skip(self);
+      if(*self->at != ')') return RegexParser_fail(self, "missing )");
+      self->at++;
+      return inner;
+    }
+    case '[':
+      return RegexParser_class(self);
+    case '.':
+      self->at++;
+      memset(node.set, 0xFF, sizeof(node.set));
+      return RegexParser_node(self, node);
+    case '"':{
+      size_t result = SIZE_MAX;
+      for(self->at++; *self->at != '\0' && *self->at != '"'; ++self->at){
+        memset(node.set, 0, sizeof(node.set));
+        RegexNode_add(&node, *self->at);
+        result = RegexParser_concat(self, result, RegexParser_node(self, node));
+      }
+      if(*self->at != '"') return RegexParser_fail(self, "missing \"");
+      self->at++;
+      if(result == SIZE_MAX) return RegexParser_fail(self, "empty text");
+      return result;
+    }
+  }
+  uint8_t byte;
+  if(!RegexParser_byte(self, &byte)) return RegexParser_fail(self, "expected hex byte");
+  RegexNode_add(&node, byte);
+  return RegexParser_node(self, node);
+}
+
+static size_t RegexParser_repeat(RegexParser* self){
+  size_t node = RegexParser_atom(self);
+  while(self->error == NULL){
+    RegexParser_skip(self);
+    size_t min, max;
+    switch(*self->at){
+      case '*': min = 0; max = REGEX_UNBOUNDED; break;
+      case '+': min = 1; max = REGEX_UNBOUNDED; break;
+      case '?': min = 0; max = 1; break;
+      case '{':
+        self->at++;
+        RegexParser_skip(self);
+        if(!RegexParser_count(self, &min)) return RegexParser_fail(self, "expected count");
+        max = min;
+        RegexParser_skip(self);
+        if(*self->at == ','){
+          self->at++;
+          RegexParser_skip(self);
+          if(!RegexParser_count(self, &max)) max = REGEX_UNBOUNDED;
+          RegexParser_skip(self);
+        }
+        if(*self->at != '}') return RegexParser_fail(self, "missing }");
+        if(min > REGEX_MAX_COUNT || (max != REGEX_UNBOUNDED && max > REGEX_MAX_COUNT)){
+          return RegexParser_fail(self, "count too large");
+        }
+        if(max < min) return RegexParser_fail(self, "count out of order");
+        break;
+      default:
+        return node;
+    }
+    self->at++;
+    node = RegexParser_node(self, (RegexNode){ .kind = RegexNode_REPEAT, .left = node, .min = min, .max = max });
+  }
+  return node;
+}
+
+static size_t RegexParser_sequence(RegexParser* self){
+  size_t result = SIZE_MAX;
+  while(self->error == NULL){
+    RegexParser_skip(self);
+    char c = *self->at;
+    if(c == '\0' || c == '|' || c == ')') break;
+    result = RegexParser_concat(self, result, RegexParser_repeat(self));
+  }
+  if(result == SIZE_MAX) result = RegexParser_node(self, (RegexNode){ .kind = RegexNode_EMPTY });
+  return result;
+}
+
+static size_t RegexParser_alternation(RegexParser* self){
+  size_t left = RegexParser_sequence(self);
+  while(self->error == NULL && *self->at == '|'){
+    self->at++;
+    size_t right = RegexParser_sequence(self);
+    left = RegexParser_node(self, (RegexNode){ .kind = RegexNode_ALTERNATE, .left = left, .right = right });
+  }
+  return left;
+}
+
+// longest match of a node, REGEX_UNBOUNDED past BYTE_REGEX_MAX_MATCH
+static size_t RegexNode_longest(RegexNode* nodes, size_t node){
+  RegexNode* self = &nodes[node];
+  size_t left, right;
+  switch(self->kind){
+    case RegexNode_EMPTY: return 0;
+    case RegexNode_SET: return 1;
+    case RegexNode_CONCAT:
+      left = RegexNode_longest(nodes, self->left);
+      right = RegexNode_longest(nodes, self->right);
+      if(left == REGEX_UNBOUNDED || right == REGEX_UNBOUNDED || left + right > BYTE_REGEX_MAX_MATCH) return REGEX_UNBOUNDED;
+      return left + right;
+    case RegexNode_ALTERNATE:
+      left = RegexNode_longest(nodes, self->left);
+      right = RegexNode_longest(nodes, self->right);
+      return left > right ? left : right;
+    case RegexNode_REPEAT:
+      left = RegexNode_longest(nodes, self->left);
+      if(left == 0) return 0;
+      if(left == REGEX_UNBOUNDED || self->max == REGEX_UNBOUNDED || left*self->max > BYTE_REGEX_MAX_MATCH) return REGEX_UNBOUNDED;
+      return left*self->max;
+  }
+  NOB_UNREACHABLE("RegexNode_longest");
+}
+
+static bool RegexNode_nullable(RegexNode* nodes, size_t node){
+  RegexNode* self = &nodes[node];
+  switch(self->kind){
+    case RegexNode_EMPTY: return true;
+    case RegexNode_SET: return false;
+    case RegexNode_CONCAT: return RegexNode_nullable(nodes, self->left) && RegexNode_nullable(nodes, self->right);
+    case RegexNode_ALTERNATE: return RegexNode_nullable(nodes, self->left) || RegexNode_nullable(nodes, self->right);
+    case RegexNode_REPEAT: return self->min == 0 || RegexNode_nullable(nodes, self->left);
+  }
+  NOB_UNREACHABLE("RegexNode_nullable");
+}
+
+typedef enum{
+  RegexState_MATCH,
+  RegexState_SET,
+  RegexState_SPLIT,
+} RegexStateKind;
+
+typedef struct{
+  RegexStateKind kind;
+  uint32_t node; // the SET node whose bytes lead to out
+  uint32_t out;
+  uint32_t out1; // other way out of a SPLIT
+} RegexState;
+
+// thompson nfa, state 0 is where matches end
+typedef struct{
+  RegexState* items;
+  size_t count;
+  size_t capacity;
+  bool overflow;
+} RegexNfa;
+
+static uint32_t RegexNfa_add(RegexNfa* self, RegexState state){
+  if(self->count >= REGEX_MAX_NFA_STATES){
+    self->overflow = true;
+    return 0;
+  }
+  nob_da_append(self, state);
+  return self->count-1;
+}
+
+// states for node that continue at next, built back to front. Reversed the
+// nfa matches the reversed bytes, which is how a match is followed back
+// from where it ends
+static uint32_t RegexNfa_compile(RegexNfa* self, RegexNode* nodes, size_t node, uint32_t next, bool reverse){
+  if(self->overflow) return 0;
+  RegexNode* it = &nodes[node];
+  switch(it->kind){
+    case RegexNode_EMPTY:
+      return next;
+    case RegexNode_SET:
+      return RegexNfa_add(self, (RegexState){ .kind = RegexState_SET, .node = node, .out = next });
+    case RegexNode_CONCAT:
+      if(reverse) return RegexNfa_compile(self, nodes, it->right, RegexNfa_compile(self, nodes, it->left, next, reverse), reverse);
+      return RegexNfa_compile(self, nodes, it->left, RegexNfa_compile(self, nodes, it->right, next, reverse), reverse);
+    case RegexNode_ALTERNATE:{
+      uint32_t left = RegexNfa_compile(self, nodes, it->left, next, reverse);
+      uint32_t right = RegexNfa_compile(self, nodes, it->right, next, reverse);
+      return RegexNfa_add(self, (RegexState){ .kind = RegexState_SPLIT, .out = left, .out1 = right });
+    }
+    case RegexNode_REPEAT:{
+      if(RegexNode_longest(nodes, it->left) == 0) return next;
+      uint32_t entry = next;
+      if(it->max == REGEX_UNBOUNDED){
+        uint32_t loop = RegexNfa_add(self, (RegexState){ .kind = RegexState_SPLIT, .out1 = next });
+        uint32_t body = RegexNfa_compile(self, nodes, it->left, loop, reverse);
+        if(self->overflow) return 0;
+        self->items[loop].out = body;
+        entry = loop;
+      }else{
+        // x{0,3} is (x(x(x)?)?)?
+        for(size_t i = it->min; i < it->max && !self->overflow; ++i){
+          uint32_t body = RegexNfa_compile(self, nodes, it->left, entry, reverse);
+          entry = RegexNfa_add(self, (RegexState){ .kind = RegexState_SPLIT, .out = body, .out1 = next });
+        }
+      }
+      for(size_t i = 0; i < it->min && !self->overflow; ++i){
+        entry = RegexNfa_compile(self, nodes, it->left, entry, reverse);
+      }
+      return entry;
+    }
+  }
+  NOB_UNREACHABLE("RegexNfa_compile");
+}
+
+typedef struct{
+  uint32_t* items;
+  size_t count;
+  size_t capacity;
+} RegexStateList;
+
+// in the lists of a leftmost dfa, between the states of matches that
+// started at different bytes, and first once a match was found
+#define REGEX_GROUP UINT32_MAX
+#define REGEX_MATCHED (UINT32_MAX-1)
+
+// subset construction, a dfa state is the sorted list of the SET and MATCH
+// states its nfa states reach without reading a byte. A leftmost dfa starts
+// a match at every byte and keeps the states grouped by where their match
+// started, earliest first. Once a group matches the later ones are dropped
+// and no new ones are started, so the last match it finds is one of the
+// leftmost start
+typedef struct{
+  RegexNfa* nfa;
+  RegexNode* nodes;
+  uint32_t start;
+  bool leftmost;
+  size_t class_count;
+  uint8_t* representative; // a byte of every class
+
+  RegexStateList lists; // the lists of all dfa states back to back
+  size_t* begin;
+  size_t* length;
+  uint32_t* table; // hash table of dfa state ids+1
+  size_t table_size;
+  size_t states;
+
+  uint32_t* mark; // generation an nfa state was last visited in
+  uint32_t generation;
+  RegexStateList stack;
+  RegexStateList closure;
+} RegexBuilder;
+
+static int RegexState_compare(const void* a, const void* b){
+  uint32_t x = *(const uint32_t*)a;
+  uint32_t y = *(const uint32_t*)b;
+  return x < y ? -1 : x > y;
+}
+
+// everything the states on the stack reach through SPLITs and no earlier
+// call in this generation did, appended to closure
+static void RegexBuilder_reach(RegexBuilder* self){
+  while(self->stack.count > 0){
+    uint32_t state = self->stack.items[--self->stack.count];
+    if(self->mark[state] == self->generation) continue;
+    self->mark[state] = self->generation;
+    RegexState* it = &self->nfa->items[state];
+    if(it->kind == RegexState_SPLIT){
+      nob_da_append(&self->stack, it->out);
+      nob_da_append(&self->stack, it->out1);
+    }else{
+      nob_da_append(&self->closure, state);
+    }
+  }
+}
+
+static void RegexBuilder_sort(RegexBuilder* self, size_t from){
+  size_t count = self->closure.count - from;
+  if(count > 1) qsort(self->closure.items + from, count, sizeof(uint32_t), RegexState_compare);
+}
+
+// everything the states on the stack reach, into closure
+static void RegexBuilder_close(RegexBuilder* self){
+  self->closure.count = 0;
+  RegexBuilder_reach(self);
+  self->generation++;
+  RegexBuilder_sort(self, 0);
+}
+
+// the leftmost dfa state one byte after state id
+static void RegexBuilder_step(RegexBuilder* self, size_t id, uint8_t byte){
+  uint32_t* list = self->lists.items + self->begin[id];
+  size_t length = self->length[id];
+  bool matched = length > 0 && list[0] == REGEX_MATCHED;
+  self->closure.count = 0;
+  nob_da_append(&self->closure, REGEX_MATCHED);
+  size_t i = matched;
+  while(i < length){
+    // a group at a time, so states an earlier group has already are left out
+    size_t from = self->closure.count;
+    for(; i < length && list[i] != REGEX_GROUP; ++i){
+      RegexState* it = &self->nfa->items[list[i]];
+      if(it->kind == RegexState_SET && RegexNode_has(&self->nodes[it->node], byte)){
+        nob_da_append(&self->stack, it->out);
+      }
+    }
+    i++;
+    RegexBuilder_reach(self);
+    RegexBuilder_sort(self, from);
+    if(self->closure.count == from) continue;
+    // sorted, so MATCH comes first
+    if(self->closure.items[from] == 0){
+      matched = true;
+      break;
+    }
+    nob_da_append(&self->closure, REGEX_GROUP);
+  }
+  if(!matched){
+    size_t from = self->closure.count;
+    nob_da_append(&self->stack, self->start);
+    RegexBuilder_reach(self);
+    RegexBuilder_sort(self, from);
+  }
+  self->generation++;
+
+  uint32_t* items = self->closure.items;
+  size_t count = self->closure.count;
+  if(count > 1 && items[count-1] == REGEX_GROUP) count--;
+  // with nothing left the flag is dropped, so that is the dead state
+  if(!matched || count == 1){
+    memmove(items, items+1, (count-1)*sizeof(uint32_t));
+    count--;
+  }
+  self->closure.count = count;
+}
+
+static uint64_t RegexBuilder_hash(uint32_t* items, size_t count){
+  uint64_t hash = 14695981039346656037ull;
+  for(size_t i = 0; i < count; ++i){
+    hash ^= items[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// id of the dfa state for the closure, adding it when it is new. Returns
+// UINT32_MAX when there would be too many
+static uint32_t RegexBuilder_intern(RegexBuilder* self){
+  uint32_t* items = self->closure.items;
+  size_t count = self->closure.count;
+  size_t slot = RegexBuilder_hash(items, count) & (self->table_size-1);
+  for(; self->table[slot] != 0; slot = (slot+1) & (self->table_size-1)){
+    uint32_t id = self->table[slot]-1;
+    if(self->length[id] == count && (count == 0 || memcmp(self->lists.items + self->begin[id], items, count*sizeof(uint32_t)) == 0)){
+      return id;
+    }
+  }
+  if(self->states == BYTE_REGEX_MAX_STATES) return UINT32_MAX;
+  uint32_t id = self->states++;
+  self->begin[id] = self->lists.count;
+  self->length[id] = count;
+  if(count > 0){
+    nob_da_reserve(&self->lists, self->lists.count + count);
+    memcpy(self->lists.items + self->lists.count, items, count*sizeof(uint32_t));
+    self->lists.count += count;
+  }
+  self->table[slot] = id+1;
+  return id;
+}
+
+static bool RegexBuilder_accepts(RegexBuilder* self, uint32_t id){
+  // MATCH is nfa state 0 and the groups are sorted, a leftmost list ends
+  // with the one that matched
+  uint32_t* list = self->lists.items + self->begin[id];
+  size_t length = self->length[id];
+  if(length == 0) return false;
+  if(!self->leftmost) return list[0] == 0;
+  size_t i = length;
+  while(i > 0 && list[i-1] != REGEX_GROUP && list[i-1] != REGEX_MATCHED) i--;
+  return i < length && list[i] == 0;
+}
+
+static bool RegexBuilder_build(RegexBuilder* self, ByteRegexDfa* dfa){
+  size_t columns = self->class_count;
+  self->table_size = 2*BYTE_REGEX_MAX_STATES;
+  self->table = calloc(self->table_size, sizeof(uint32_t));
+  self->begin = malloc(BYTE_REGEX_MAX_STATES*sizeof(size_t));
+  self->length = malloc(BYTE_REGEX_MAX_STATES*sizeof(size_t));
+  self->mark = calloc(self->nfa->count, sizeof(uint32_t));
+  self->generation = 1;
+  NOB_ASSERT(self->table != NULL && self->begin != NULL && self->length != NULL && self->mark != NULL && "Buy more RAM lol");
+
+  // the dead state is 0
+  self->closure.count = 0;
+  RegexBuilder_intern(self);
+  nob_da_append(&self->stack, self->start);
+  RegexBuilder_close(self);
+  uint32_t start = RegexBuilder_intern(self);
+
+  bool result = true;
+  size_t capacity = 16;
+  uint32_t* next = calloc(capacity*columns, sizeof(uint32_t));
+  NOB_ASSERT(next != NULL && "Buy more RAM lol");
+  for(size_t id = 1; id < self->states; ++id){
+    if(id >= capacity){
+      next = realloc(next, 2*capacity*columns*sizeof(uint32_t));
+      NOB_ASSERT(next != NULL && "Buy more RAM lol");
+      memset(next + capacity*columns, 0, capacity*columns*sizeof(uint32_t));
+      capacity *= 2;
+    }
+    for(size_t column = 0; column < columns; ++column){
+      uint8_t byte = self->representative[column];
+      if(self->leftmost){
+        RegexBuilder_step(self, id, byte);
+      }else{
+        for(size_t i = 0; i < self->length[id]; ++i){
+          RegexState* it = &self->nfa->items[self->lists.items[self->begin[id] + i]];
+          if(it->kind == RegexState_SET && RegexNode_has(&self->nodes[it->node], byte)){
+            nob_da_append(&self->stack, it->out);
+          }
+        }
+        RegexBuilder_close(self);
+      }
+      uint32_t target = RegexBuilder_intern(self);
+      if(target == UINT32_MAX){
+        result = false;
+        goto done;
+      }
+      next[id*columns + column] = target*columns | (RegexBuilder_accepts(self, target) ? BYTE_REGEX_ACCEPT : 0);
+    }
+  }
+
+done:
+  if(result){
+    dfa->next = next;
+    dfa->states = self->states;
+    dfa->start = start*columns;
+  }else{
+    free(next);
+  }
+  free(self->table);
+  free(self->begin);
+  free(self->length);
+  free(self->mark);
+  self->lists.count = 0;
+  self->states = 0;
+  return result;
+}
+
+// splits the bytes into classes no SET node tells apart
+static void ByteRegex_classify(ByteRegex* self, RegexNodes* nodes, uint8_t* representative){
+  memset(self->classes, 0, sizeof(self->classes));
+  self->class_count = 1;
+  for(size_t i = 0; i < nodes->count; ++i){
+    RegexNode* node = &nodes->items[i];
+    if(node->kind != RegexNode_SET) continue;
+    // every class is split into the bytes in the set and those that are not
+    uint16_t split[256*2];
+    memset(split, 0xFF, sizeof(split));
+    size_t count = 0;
+    for(size_t byte = 0; byte < 256; ++byte){
+      size_t key = self->classes[byte]*2 + RegexNode_has(node, byte);
+      if(split[key] == 0xFFFF) split[key] = count++;
+      self->classes[byte] = split[key];
+    }
+    self->class_count = count;
+  }
+  for(size_t byte = 256; byte-- > 0;) representative[self->classes[byte]] = byte;
+}
+
+bool ByteRegex_compile(ByteRegex* self, const char* text){
+  memset(self, 0, sizeof(*self));
+  bool result = true;
+  RegexParser parser = { .at = text };
+  RegexNfa nfa = {0};
+  RegexNfa reversed = {0};
+  RegexBuilder builder = {0};
+
+  size_t root = RegexParser_alternation(&parser);
+  RegexParser_skip(&parser);
+  if(parser.error == NULL && *parser.at != '\0') RegexParser_fail(&parser, "unexpected )");
+  if(parser.error != NULL){
+    nob_log(NOB_ERROR, "ByteRegex_compile: %s at %zu", parser.error, (size_t)(parser.at - text));
+    nob_return_defer(false);
+  }
+  // every position would match
+  if(RegexNode_nullable(parser.nodes.items, root)){
+    nob_log(NOB_ERROR, "ByteRegex_compile: pattern matches no bytes at all");
+    nob_return_defer(false);
+  }
+  size_t longest = RegexNode_longest(parser.nodes.items, root);
+  self->longest = longest == REGEX_UNBOUNDED ? BYTE_REGEX_MAX_MATCH : longest;
+
+  RegexNfa_add(&nfa, (RegexState){ .kind = RegexState_MATCH });
+  uint32_t start = RegexNfa_compile(&nfa, parser.nodes.items, root, 0, false);
+  RegexNfa_add(&reversed, (RegexState){ .kind = RegexState_MATCH });
+  uint32_t reversed_start = RegexNfa_compile(&reversed, parser.nodes.items, root, 0, true);
+  if(nfa.overflow || reversed.overflow){
+    nob_log(NOB_ERROR, "ByteRegex_compile: pattern too large");
+    nob_return_defer(false);
+  }
+
+  uint8_t representative[256];
+  ByteRegex_classify(self, &parser.nodes, representative);
+  builder.nodes = parser.nodes.items;
+  builder.class_count = self->class_count;
+  builder.representative = representative;
+
+  builder.nfa = &nfa;
+  builder.start = start;
+  builder.leftmost = false;
+  bool built = RegexBuilder_build(&builder, &self->anchored);
+  builder.leftmost = true;
+  built = built && RegexBuilder_build(&builder, &self->forward);
+  builder.nfa = &reversed;
+  builder.start = reversed_start;
+  builder.leftmost = false;
+  built = built && RegexBuilder_build(&builder, &self->reverse);
+  if(!built){
+    nob_log(NOB_ERROR, "ByteRegex_compile: pattern is too complex");
+    nob_return_defer(false);
+  }
+
+  size_t leaving = 0;
+  for(size_t byte = 0; byte < 256; ++byte){
+    self->leaves[byte] = self->forward.next[self->forward.start + self->classes[byte]] != self->forward.start;
+    if(self->leaves[byte]){
+      self->single = byte;
+      leaving++;
+    }
+  }
+  if(leaving != 1) self->single = -1;
+  self->skip = leaving <= BYTE_REGEX_SKIP_CANDIDATES;
+
+defer:
+  if(!result) ByteRegex_free(self);
+  nob_da_free(parser.nodes);
+  nob_da_free(nfa);
+  nob_da_free(reversed);
+  nob_da_free(builder.lists);
+  nob_da_free(builder.stack);
+  nob_da_free(builder.closure);
+  return result;
+}
+
+void ByteRegex_free(ByteRegex* self){
+  free(self->forward.next);
+  free(self->reverse.next);
+  free(self->anchored.next);
+  memset(self, 0, sizeof(*self));
+}
+
+// first byte at or after i that leaves the forward start state
+static size_t ByteRegex_skip(ByteRegex* self, const uint8_t* haystack, size_t size, size_t i){
+  if(self->single >= 0){
+    const uint8_t* found = memchr(haystack + i, self->single, size - i);
+    return found == NULL ? size : (size_t)(found - haystack);
+  }
+  while(i < size && !self->leaves[haystack[i]]) i++;
+  return i;
+}
+
+// where the first match starting at or after i ends, SIZE_MAX when none
+// does before size, and the forward state there. Without skipping the loop
+// is kept free of the start state check, on random data that branch is a
+// coin flip
+static size_t ByteRegex_earliest(ByteRegex* self, const uint8_t* haystack, size_t size, size_t i,
+    uint32_t* found){
+  const uint8_t* classes = self->classes;
+  const uint32_t* next = self->forward.next;
+  uint32_t start = self->forward.start;
+  uint32_t state = start;
+  if(!self->skip){
+    for(; i < size; ++i){
+      state = next[state + classes[haystack[i]]];
+      if(state & BYTE_REGEX_ACCEPT) break;
+    }
+  }else{
+    for(; i < size; ++i){
+      if(state == start){
+        i = ByteRegex_skip(self, haystack, size, i);
+        if(i == size) break;
+      }
+      state = next[state + classes[haystack[i]]];
+      if(state & BYTE_REGEX_ACCEPT) break;
+    }
+  }
+  if(i >= size) return SIZE_MAX;
+  *found = state;
+  return i+1;
+}
+
+bool ByteRegex_find(ByteRegex* self, const uint8_t* haystack, size_t size, size_t at,
+    size_t* start, size_t* end){
+  const uint8_t* classes = self->classes;
+  uint32_t state = 0;
+  size_t last = ByteRegex_earliest(self, haystack, size, at, &state);
+  if(last == SIZE_MAX) return false;
+
+  // on until the dfa dies, the last match it finds starts leftmost. None
+  // of that start can end further on than longest past the first
+  const uint32_t* next = self->forward.next;
+  size_t stop = size - last > self->longest ? last + self->longest : size;
+  for(size_t i = last; i < stop; ++i){
+    state = next[(state & ~BYTE_REGEX_ACCEPT) + classes[haystack[i]]];
+    if(state == 0) break;
+    if(state & BYTE_REGEX_ACCEPT) last = i+1;
+  }
+
+  // back to where that match starts
+  next = self->reverse.next;
+  state = self->reverse.start;
+  size_t first = last;
+  for(size_t i = last; i > at; --i){
+    state = next[(state & ~BYTE_REGEX_ACCEPT) + classes[haystack[i-1]]];
+    if(state == 0) break;
+    if(state & BYTE_REGEX_ACCEPT) first = i-1;
+  }
+  NOB_ASSERT(first < last);
+
+  // and on to the longest match from there
+  next = self->anchored.next;
+  state = self->anchored.start;
+  stop = size - first > self->longest ? first + self->longest : size;
+  for(size_t i = first; i < stop; ++i){
+    state = next[(state & ~BYTE_REGEX_ACCEPT) + classes[haystack[i]]];
+    if(state == 0) break;
+    if(state & BYTE_REGEX_ACCEPT) last = i+1;
+  }
+  *start = first;
+  *end = last;
+  return true;
+}
+
+void ByteRegex_scan(ByteRegex* self, const uint8_t* haystack, size_t size, size_t limit,
+    size_t base, SearchHits* hits){
+  if(limit > size) limit = size;
+  size_t at = 0;
+  while(at < limit && hits->count < SEARCH_MAX_HITS){
+    size_t start, end;
+    if(!ByteRegex_find(self, haystack, size, at, &start, &end) || start >= limit) break;
+    SearchHits_add(hits, base + start, end - start, 0);
+    at = end;
+  }
+}
@@ -0,0 +1,71 @@
+#ifndef BYTE_REGEX_H_
+#define BYTE_REGEX_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "search.h"
+
+// states one dfa may have before the pattern is turned down as too complex
+#ifndef BYTE_REGEX_MAX_STATES
+#define BYTE_REGEX_MAX_STATES 4096
+#endif // BYTE_REGEX_MAX_STATES
+
+// matches of patterns with * + or {n,} are cut off after this many bytes,
+// it is also how far a SearchJob chunk reads on into the next one
+#ifndef BYTE_REGEX_MAX_MATCH
+#define BYTE_REGEX_MAX_MATCH (64*1024)
+#endif // BYTE_REGEX_MAX_MATCH
+
+// with more bytes than this leaving the start state skipping ahead costs
+// more than it saves
+#define BYTE_REGEX_SKIP_CANDIDATES 32
+
+// set on transitions into accepting states
+#define BYTE_REGEX_ACCEPT 0x80000000u
+
+// transitions are indexed by state*classes + class, and state ids are
+// stored multiplied already, 0 is the dead state
+typedef struct{
+  uint32_t* next;
+  size_t states;
+  uint32_t start;
+} ByteRegexDfa;
+
+// a regular expression over bytes compiled to dfas. Bytes that no part of
+// the pattern tells apart share a class, so the tables have a column per
+// class instead of 256
+struct ByteRegex{
+  uint8_t classes[256];
+  size_t class_count;
+  ByteRegexDfa forward;  // unanchored, finds an end of a leftmost match
+  ByteRegexDfa reverse;  // backwards from an end, finds where that match starts
+  ByteRegexDfa anchored; // from a start, finds the longest match
+  size_t longest;        // longest match, BYTE_REGEX_MAX_MATCH when unbounded
+
+  // bytes that take the forward dfa out of its start state, the scan skips
+  // ahead to the next one when there are few of them, with memchr when
+  // there is only one
+  bool leaves[256];
+  bool skip;
+  int single; // that one byte, -1 when there are more
+};
+
+// compiles hex bytes like 4D 5A, "text", . for any byte, classes like
+// [00-1F 7F] or [^00], groups, | and the * + ? {n} {n,} {n,m} repetitions.
+// Patterns that can match zero bytes are turned down
+bool ByteRegex_compile(ByteRegex* self, const char* text);
+void ByteRegex_free(ByteRegex* self);
+
+// the leftmost longest match starting at or after at, in [start, end).
+// Returns false when there is none that ends before size
+bool ByteRegex_find(ByteRegex* self, const uint8_t* haystack, size_t size, size_t at,
+    size_t* start, size_t* end);
+// appends base+i, length for the leftmost longest match starting at every
+// i < limit that is not inside an earlier match, in order. Matches may run
+// past limit but not past size
+void ByteRegex_scan(ByteRegex* self, const uint8_t* haystack, size_t size, size_t limit,
+    size_t base, SearchHits* hits);
+
+#endif // BYTE_REGEX_H_
@@ -0,0 +1,133 @@
+#include "nob.h"
+
+#include "gather.h"
+#include "column_cache.h"
+
+void ColumnCache_init(ColumnCache* self, size_t budget){
+  *self = (ColumnCache){
+    .budget = budget,
+    .type_edits = type_edits,
+  };
+}
+
+void ColumnCache_clear(ColumnCache* self){
+  for(size_t i = 0; i < self->chunks.count; ++i){
+    free(self->chunks.items[i].items);
+  }
+  self->chunks.count = 0;
+  self->count = 0;
+  self->used = 0;
+}
+
+void ColumnCache_free(ColumnCache* self){
+  ColumnCache_clear(self);
+  nob_da_free(self->chunks);
+  nob_da_free(*self);
+  ColumnCache_init(self, self->budget);
+}
+
+void ColumnCache_sync(ColumnCache* self, size_t generation){
+  if(self->type_edits == type_edits && self->generation == generation) return;
+  ColumnCache_clear(self);
+  self->type_edits = type_edits;
+  self->generation = generation;
+}
+
+static Column* ColumnCache_column(ColumnCache* self, TypeProgram* program, TypeOp* op,
+    size_t base, size_t stride){
+  Column key = {
+    .root = program->root->id,
+    .field = op->type->id,
+    .base = base,
+    .stride = stride,
+  };
+  for(size_t i = 0; i < self->count; ++i){
+    Column* column = &self->items[i];
+    if(column->root == key.root && column->field == key.field
+        && column->base == key.base && column->stride == key.stride){
+      return column;
+    }
+  }
+
+  key.size = gather_field_size(op);
+  key.chunk_records = COLUMN_CHUNK_SIZE/key.size;
+  if(key.chunk_records == 0) key.chunk_records = 1;
+  key.last_chunk = SIZE_MAX;
+  nob_da_append(self, key);
+  return &self->items[self->count-1];
+}
+
+static void ColumnCache_evict(ColumnCache* self, size_t size){
+  while(self->used + size > self->budget && self->chunks.count > 0){
+    size_t victim = 0;
+    for(size_t i = 1; i < self->chunks.count; ++i){
+      if(self->chunks.items[i].last_used < self->chunks.items[victim].last_used) victim = i;
+    }
+    ColumnChunk* chunk = &self->chunks.items[victim];
+    self->used -= self->items[chunk->column].size*self->items[chunk->column].chunk_records;
+    free(chunk->items);
+    *chunk = self->chunks.items[--self->chunks.count];
+
+    // chunks moved around, the hints have to be looked up again
+    for(size_t i = 0; i < self->count; ++i) self->items[i].last_chunk = SIZE_MAX;
+  }
+}
+
+static bool ColumnChunk_contains(ColumnChunk* self, size_t column, size_t record){
+  return self->column == column && record >= self->first && record < self->first + self->count;
+}
+
+const uint8_t* ColumnCache_get(ColumnCache* self, DataSource* source, TypeProgram* program,
+    TypeOp* op, size_t base, size_t stride, size_t count, size_t record, size_t* available){
+  if(record >= count || gather_field_size(op) == 0) return NULL;
+  Column* column = ColumnCache_column(self, program, op, base, stride);
+  size_t column_index = column - self->items;
+  self->tick++;
+
+  ColumnChunk* chunk = NULL;
+  if(column->last_chunk != SIZE_MAX
+      && ColumnChunk_contains(&self->chunks.items[column->last_chunk], column_index, record)){
+    chunk = &self->chunks.items[column->last_chunk];
+  }else{
+    for(size_t i = 0; i < self->chunks.count; ++i){
+      if(ColumnChunk_contains(&self->chunks.items[i], column_index, record)){
+        chunk = &self->chunks.items[i];
+        break;
+      }
+    }
+  }
+
+  if(chunk != NULL){
+    self->hits++;
+  }else{
+    self->misses++;
+    size_t bytes = column->size*column->chunk_records;
+    ColumnCache_evict(self, bytes);
+
+    size_t first = record - record%column->chunk_records;
+    size_t n = count - first;
+    if(n > column->chunk_records) n = column->chunk_records;
+    ColumnChunk fresh = {
+      .column = column_index,
+      .first = first,
+      .items = malloc(bytes),
+    };
+    if(fresh.items == NULL){
+      nob_log(NOB_ERROR, "ColumnCache_get: could not allocate %zu bytes", bytes);
+      return NULL;
+    }
+    fresh.count = gather_field(source, op, base, stride, first, n, fresh.items);
+    if(record >= first + fresh.count){
+      free(fresh.items);
+      return NULL;
+    }
+    nob_da_append(&self->chunks, fresh);
+    self->used += bytes;
+    chunk = &self->chunks.items[self->chunks.count-1];
+  }
+
+  chunk->last_used = self->tick;
+  column->last_chunk = chunk - self->chunks.items;
+  if(available != NULL) *available = chunk->first + chunk->count - record;
+  return chunk->items + (record - chunk->first)*column->size;
+}
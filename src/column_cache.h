@@ -0,0 +1,83 @@
+#ifndef COLUMN_CACHE_H_
+#define COLUMN_CACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "data_source.h"
+#include "type.h"
+
+#ifndef COLUMN_CACHE_DEFAULT_BUDGET
+#define COLUMN_CACHE_DEFAULT_BUDGET (64*1024*1024)
+#endif // COLUMN_CACHE_DEFAULT_BUDGET
+
+// decoded bytes per chunk, the number of records in a chunk follows from the
+// size of the field
+#ifndef COLUMN_CHUNK_SIZE
+#define COLUMN_CHUNK_SIZE (64*1024)
+#endif // COLUMN_CHUNK_SIZE
+
+// one field of an array of records
+typedef struct{
+  TypeId root;
+  TypeId field;
+  size_t base;
+  size_t stride;
+  size_t size;          // bytes per decoded element
+  size_t chunk_records;
+  size_t last_chunk;    // index into chunks of the last hit, SIZE_MAX if none
+} Column;
+
+// a run of consecutive records of a single column
+typedef struct{
+  size_t column;
+  size_t first;
+  size_t count;
+  size_t last_used;
+  uint8_t* items;
+} ColumnChunk;
+
+// decoded fields of record arrays stored column by column, so anything going
+// over many records of a field reads a dense array instead of decoding the
+// raw bytes again. Chunks are decoded on first use and the least recently
+// used ones are dropped once the budget is exceeded
+typedef struct{
+  Column* items;
+  size_t count;
+  size_t capacity;
+
+  struct{
+    ColumnChunk* items;
+    size_t count;
+    size_t capacity;
+  } chunks;
+
+  size_t budget;
+  size_t used;
+  size_t tick;
+
+  // what the cached columns were decoded from
+  size_t type_edits;
+  size_t generation;
+
+  size_t hits;
+  size_t misses;
+} ColumnCache;
+
+void ColumnCache_init(ColumnCache* self, size_t budget);
+void ColumnCache_clear(ColumnCache* self);
+void ColumnCache_free(ColumnCache* self);
+
+// drops every column when a Type was edited or the data changed since the
+// columns were decoded
+void ColumnCache_sync(ColumnCache* self, size_t generation);
+
+// decoded field op of record out of count records of program->root starting
+// at base, stride bytes apart. available is set to the number of records
+// following in the same contiguous chunk, including record itself. The
+// pointer stays valid until the next call, NULL when it could not be decoded
+const uint8_t* ColumnCache_get(ColumnCache* self, DataSource* source, TypeProgram* program,
+    TypeOp* op, size_t base, size_t stride, size_t count, size_t record, size_t* available);
+
+#endif // COLUMN_CACHE_H_
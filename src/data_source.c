@@ -0,0 +1,131 @@
+#include "nob.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "data_source.h"
+
+bool DataSource_open(DataSource* self, const char* path, size_t memory_budget){
+  *self = (DataSource){ .fd = -1 };
+
+  int fd = open(path, O_RDONLY);
+  if(fd < 0){
+    nob_log(NOB_ERROR, "DataSource_open: could not open '%s': %s", path, strerror(errno));
+    return false;
+  }
+
+  struct stat st;
+  if(fstat(fd, &st) < 0){
+    nob_log(NOB_ERROR, "DataSource_open: could not stat '%s': %s", path, strerror(errno));
+    close(fd);
+    return false;
+  }
+
+  self->fd = fd;
+  self->count = st.st_size;
+  // mmap refuses zero length mappings, an empty file simply has no items
+  if(self->count == 0) return true;
+
+  if(self->count > memory_budget){
+    self->kind = DataSource_CACHED;
+    if(!BlockCache_init(&self->cache, fd, self->count, memory_budget)){
+      close(fd);
+      *self = (DataSource){ .fd = -1 };
+      return false;
+    }
+    nob_log(NOB_INFO, "DataSource_open: caching '%s' (%zu bytes)", path, self->count);
+    return true;
+  }
+
+  void* items = mmap(NULL, self->count, PROT_READ, MAP_PRIVATE, fd, 0);
+  if(items == MAP_FAILED){
+    nob_log(NOB_ERROR, "DataSource_open: could not map '%s': %s", path, strerror(errno));
+    close(fd);
+    *self = (DataSource){ .fd = -1 };
+    return false;
+  }
+  self->kind = DataSource_MMAP;
+  self->items = items;
+
+  // the viewer jumps around, so disable the kernels large sequential readahead
+  madvise(items, self->count, MADV_RANDOM);
+
+  nob_log(NOB_INFO, "DataSource_open: mapped '%s' (%zu bytes)", path, self->count);
+  return true;
+}
+
+void DataSource_close(DataSource* self){
+  if(self->items != NULL) munmap((void*)self->items, self->count);
+  if(self->kind == DataSource_CACHED) BlockCache_free(&self->cache);
+  if(self->fd >= 0) close(self->fd);
+  *self = (DataSource){ .fd = -1 };
+}
+
+const uint8_t* DataSource_peek(DataSource* self, size_t offset, size_t* size){
+  *size = 0;
+  if(offset >= self->count) return NULL;
+
+  switch(self->kind){
+    case DataSource_MMAP:{
+      *size = self->count - offset;
+      return self->items + offset;
+    }
+    case DataSource_CACHED:{
+      CacheBlock* block = BlockCache_get(&self->cache, offset);
+      if(block == NULL) return NULL;
+      size_t block_offset = offset % BLOCK_CACHE_BLOCK_SIZE;
+      *size = block->size - block_offset;
+      return block->items + block_offset;
+    }
+  }
+  return NULL;
+}
+
+size_t DataSource_read(DataSource* self, size_t offset, void* dst, size_t size){
+  size_t done = 0;
+  while(done < size){
+    size_t available = 0;
+    const uint8_t* src = DataSource_peek(self, offset+done, &available);
+    if(src == NULL) break;
+    if(available > size-done) available = size-done;
+    memcpy((uint8_t*)dst + done, src, available);
+    done += available;
+  }
+  return done;
+}
+
+const uint8_t* DataSource_scan(DataSource* self, size_t offset, size_t size, uint8_t* buffer, size_t* got){
+  *got = 0;
+  if(offset >= self->count) return NULL;
+  if(size > self->count - offset) size = self->count - offset;
+
+  if(self->kind == DataSource_MMAP){
+    *got = size;
+    return self->items + offset;
+  }
+
+  size_t done = 0;
+  while(done < size){
+    ssize_t n = pread(self->fd, buffer + done, size - done, offset + done);
+    if(n < 0 && errno == EINTR) continue;
+    if(n <= 0){
+      if(n < 0) nob_log(NOB_ERROR, "DataSource_scan: could not read at %zu: %s", offset+done, strerror(errno));
+      break;
+    }
+    done += n;
+  }
+  *got = done;
+  return done > 0 ? buffer : NULL;
+}
+
+void DataSource_will_need(DataSource* self, size_t offset, size_t size){
+  if(self->kind != DataSource_MMAP || self->items == NULL || offset >= self->count) return;
+  if(size > self->count - offset) size = self->count - offset;
+
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  size_t begin = offset & ~(page_size-1);
+  madvise((void*)(self->items + begin), size + (offset-begin), MADV_WILLNEED);
+}
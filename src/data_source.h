@@ -0,0 +1,49 @@
+#ifndef DATA_SOURCE_H_
+#define DATA_SOURCE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "block_cache.h"
+
+#ifndef DATA_SOURCE_DEFAULT_BUDGET
+#define DATA_SOURCE_DEFAULT_BUDGET (256*1024*1024)
+#endif // DATA_SOURCE_DEFAULT_BUDGET
+
+typedef enum{
+  DataSource_MMAP = 0,
+  DataSource_CACHED,
+} DataSourceKind;
+
+// read-only view of the file being inspected, files that fit in the memory
+// budget are mmapped so only the pages that are looked at become resident,
+// larger files go through a BlockCache so resident memory stays capped
+typedef struct{
+  DataSourceKind kind;
+  int fd;
+  size_t count;
+  const uint8_t* items; // only set for DataSource_MMAP
+  BlockCache cache;     // only used by DataSource_CACHED
+} DataSource;
+
+bool DataSource_open(DataSource* self, const char* path, size_t memory_budget);
+void DataSource_close(DataSource* self);
+
+// returns a pointer to the bytes at offset and stores how many of them are
+// contiguous in size, the pointer is valid until the next call into the source
+const uint8_t* DataSource_peek(DataSource* self, size_t offset, size_t* size);
+
+// copies up to size bytes at offset into dst, returns how many were copied
+size_t DataSource_read(DataSource* self, size_t offset, void* dst, size_t size);
+
+// thread safe read for background scans, mapped files hand out their memory
+// directly, otherwise up to size bytes are pread into buffer which bypasses
+// the block cache so a scan does not evict what is on screen. Stores the
+// number of bytes available in got
+const uint8_t* DataSource_scan(DataSource* self, size_t offset, size_t size, uint8_t* buffer, size_t* got);
+
+// hint that [offset, offset+size) is about to be read
+void DataSource_will_need(DataSource* self, size_t offset, size_t size);
+
+#endif // DATA_SOURCE_H_
@@ -0,0 +1,287 @@
+#include "nob.h"
+
+#include <immintrin.h>
+
+#include "gather.h"
+
+static void bswap_element(uint8_t* x, size_t size){
+  for(size_t i = 0; i < size/2; ++i){
+    uint8_t t = x[i];
+    x[i] = x[size-1-i];
+    x[size-1-i] = t;
+  }
+}
+
+static void gather_scalar(void* dst, const uint8_t* src, size_t stride, size_t count, size_t size, bool swap){
+  uint8_t* out = dst;
+  switch(size){
+    // fixed sizes let the compiler turn the copies into single moves
+    case 1: for(size_t i = 0; i < count; ++i) out[i] = src[i*stride]; return;
+    case 2:{
+      for(size_t i = 0; i < count; ++i){
+        uint16_t x;
+        memcpy(&x, src + i*stride, 2);
+        if(swap) x = __builtin_bswap16(x);
+        memcpy(out + i*2, &x, 2);
+      }
+    }return;
+    case 4:{
+      for(size_t i = 0; i < count; ++i){
+        uint32_t x;
+        memcpy(&x, src + i*stride, 4);
+        if(swap) x = __builtin_bswap32(x);
+        memcpy(out + i*4, &x, 4);
+      }
+    }return;
+    case 8:{
+      for(size_t i = 0; i < count; ++i){
+        uint64_t x;
+        memcpy(&x, src + i*stride, 8);
+        if(swap) x = __builtin_bswap64(x);
+        memcpy(out + i*8, &x, 8);
+      }
+    }return;
+    default:{
+      for(size_t i = 0; i < count; ++i){
+        memcpy(out + i*size, src + i*stride, size);
+        if(swap) bswap_element(out + i*size, size);
+      }
+    }return;
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("ssse3")))
+static void gather_ssse3(void* dst, const uint8_t* src, size_t stride, size_t count, size_t size, bool swap){
+  uint8_t* out = dst;
+  size_t i = 0;
+  if(size == 4){
+    const __m128i bswap = _mm_setr_epi8(3,2,1,0, 7,6,5,4, 11,10,9,8, 15,14,13,12);
+    for(; i+4 <= count; i += 4){
+      uint32_t a, b, c, d;
+      memcpy(&a, src + (i+0)*stride, 4);
+      memcpy(&b, src + (i+1)*stride, 4);
+      memcpy(&c, src + (i+2)*stride, 4);
+      memcpy(&d, src + (i+3)*stride, 4);
+      __m128i x = _mm_setr_epi32(a, b, c, d);
+      if(swap) x = _mm_shuffle_epi8(x, bswap);
+      _mm_storeu_si128((__m128i*)(out + i*4), x);
+    }
+  }else if(size == 8){
+    const __m128i bswap = _mm_setr_epi8(7,6,5,4,3,2,1,0, 15,14,13,12,11,10,9,8);
+    for(; i+2 <= count; i += 2){
+      __m128i lo = _mm_loadl_epi64((const __m128i*)(src + (i+0)*stride));
+      __m128i hi = _mm_loadl_epi64((const __m128i*)(src + (i+1)*stride));
+      __m128i x = _mm_unpacklo_epi64(lo, hi);
+      if(swap) x = _mm_shuffle_epi8(x, bswap);
+      _mm_storeu_si128((__m128i*)(out + i*8), x);
+    }
+  }
+  gather_scalar(out + i*size, src + i*stride, stride, count-i, size, swap);
+}
+
+__attribute__((target("avx2")))
+static void gather_avx2(void* dst, const uint8_t* src, size_t stride, size_t count, size_t size, bool swap){
+  uint8_t* out = dst;
+  size_t i = 0;
+  // the hardware gather takes 32 bit indices
+  if(stride*8 < INT32_MAX && size == 4){
+    const __m256i bswap = _mm256_setr_epi8(
+        3,2,1,0, 7,6,5,4, 11,10,9,8, 15,14,13,12,
+        3,2,1,0, 7,6,5,4, 11,10,9,8, 15,14,13,12);
+    const __m256i index = _mm256_mullo_epi32(_mm256_setr_epi32(0,1,2,3,4,5,6,7), _mm256_set1_epi32(stride));
+    for(; i+8 <= count; i += 8){
+      __m256i x = _mm256_i32gather_epi32((const int*)(src + i*stride), index, 1);
+      if(swap) x = _mm256_shuffle_epi8(x, bswap);
+      _mm256_storeu_si256((__m256i*)(out + i*4), x);
+    }
+  }else if(stride*4 < INT32_MAX && size == 8){
+    const __m256i bswap = _mm256_setr_epi8(
+        7,6,5,4,3,2,1,0, 15,14,13,12,11,10,9,8,
+        7,6,5,4,3,2,1,0, 15,14,13,12,11,10,9,8);
+    const __m128i index = _mm_mullo_epi32(_mm_setr_epi32(0,1,2,3), _mm_set1_epi32(stride));
+    for(; i+4 <= count; i += 4){
+      __m256i x = _mm256_i32gather_epi64((const long long*)(src + i*stride), index, 1);
+      if(swap) x = _mm256_shuffle_epi8(x, bswap);
+      _mm256_storeu_si256((__m256i*)(out + i*8), x);
+    }
+  }
+  gather_scalar(out + i*size, src + i*stride, stride, count-i, size, swap);
+}
+
+#endif
+
+// words of elements with 8 bytes left in the span are loaded whole, the ones
+// at the end byte by byte so nothing past the last element is read
+static size_t gather_bits_whole(size_t stride, size_t count, size_t length){
+  size_t span = (count-1)*stride + length;
+  if(span < 8) return 0;
+  size_t whole = (span - 8)/stride + 1;
+  return whole < count ? whole : count;
+}
+
+static uint64_t gather_bits_word(const uint8_t* src, size_t length){
+  uint64_t word = 0;
+  for(size_t i = 0; i < length; ++i) word |= (uint64_t)src[i] << (i*8);
+  return word;
+}
+
+static uint64_t gather_bits_load(const uint8_t* src){
+  uint64_t word;
+  memcpy(&word, src, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  word = __builtin_bswap64(word);
+#endif
+  return word;
+}
+
+static void gather_bits_scalar(uint64_t* dst, const uint8_t* src, size_t stride, size_t count,
+    size_t length, size_t shift, size_t width){
+  uint64_t mask = UINT64_MAX >> (64 - width);
+  size_t whole = gather_bits_whole(stride, count, length);
+  for(size_t i = 0; i < whole; ++i){
+    dst[i] = (gather_bits_load(src + i*stride) >> shift) & mask;
+  }
+  for(size_t i = whole; i < count; ++i){
+    dst[i] = (gather_bits_word(src + i*stride, length) >> shift) & mask;
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// shrx and bzhi do the shift and mask without flags or a mask register
+__attribute__((target("bmi2")))
+static void gather_bits_bmi2(uint64_t* dst, const uint8_t* src, size_t stride, size_t count,
+    size_t length, size_t shift, size_t width){
+  size_t whole = gather_bits_whole(stride, count, length);
+  for(size_t i = 0; i < whole; ++i){
+    dst[i] = _bzhi_u64(gather_bits_load(src + i*stride) >> shift, width);
+  }
+  for(size_t i = whole; i < count; ++i){
+    dst[i] = _bzhi_u64(gather_bits_word(src + i*stride, length) >> shift, width);
+  }
+}
+
+#endif
+
+typedef void (*GatherKernel)(void* dst, const uint8_t* src, size_t stride, size_t count, size_t size, bool swap);
+typedef void (*GatherBitsKernel)(uint64_t* dst, const uint8_t* src, size_t stride, size_t count,
+    size_t length, size_t shift, size_t width);
+
+static GatherKernel gather_kernel = NULL;
+static const char* gather_kernel_label = "scalar";
+static GatherBitsKernel gather_bits_kernel = NULL;
+
+// both kernels at once, so the one call to gather_kernel_name before the
+// workers start covers gather_bits too
+static void gather_resolve(void){
+  gather_kernel = gather_scalar;
+  gather_bits_kernel = gather_bits_scalar;
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("bmi2")) gather_bits_kernel = gather_bits_bmi2;
+  if(__builtin_cpu_supports("avx2")){
+    gather_kernel = gather_avx2;
+    gather_kernel_label = "avx2";
+  }else if(__builtin_cpu_supports("ssse3")){
+    gather_kernel = gather_ssse3;
+    gather_kernel_label = "ssse3";
+  }
+#endif
+}
+
+void gather(void* dst, const uint8_t* src, size_t stride, size_t count, size_t size, bool swap){
+  if(gather_kernel == NULL) gather_resolve();
+  gather_kernel(dst, src, stride, count, size, swap);
+}
+
+const char* gather_kernel_name(void){
+  if(gather_kernel == NULL) gather_resolve();
+  return gather_kernel_label;
+}
+
+void gather_bits(uint64_t* dst, const uint8_t* src, size_t stride, size_t count,
+    size_t length, size_t shift, size_t width){
+  if(gather_kernel == NULL) gather_resolve();
+  if(count == 0) return;
+  gather_bits_kernel(dst, src, stride, count, length, shift, width);
+}
+
+size_t gather_field_size(TypeOp* op){
+  return op->kind == Type_BITS ? sizeof(uint64_t) : op->length;
+}
+
+void gather_op(TypeOp* op, void* dst, const uint8_t* src, size_t stride, size_t count){
+  if(op->kind == Type_BITS){
+    gather_bits(dst, src, stride, count, op->length, op->shift, op->width);
+  }else{
+    gather(dst, src, stride, count, op->length, type_kinds[op->kind].swap);
+  }
+}
+
+size_t DataSource_gather(DataSource* self, void* dst, size_t offset, size_t stride,
+    size_t count, size_t size, bool swap){
+  uint8_t* out = dst;
+  size_t done = 0;
+  while(done < count){
+    size_t element = offset + done*stride;
+    size_t available = 0;
+    const uint8_t* src = DataSource_peek(self, element, &available);
+    if(src == NULL) break;
+
+    if(available < size){
+      // the element straddles two cache blocks
+      if(DataSource_read(self, element, out + done*size, size) != size) break;
+      if(swap) bswap_element(out + done*size, size);
+      done++;
+      continue;
+    }
+
+    size_t n = (available - size)/stride + 1;
+    if(n > count - done) n = count - done;
+    gather(out + done*size, src, stride, n, size, swap);
+    done += n;
+  }
+  return done;
+}
+
+static size_t DataSource_gather_bits(DataSource* self, uint64_t* dst, size_t offset, size_t stride,
+    size_t count, TypeOp* op){
+  size_t done = 0;
+  while(done < count){
+    size_t element = offset + done*stride;
+    size_t available = 0;
+    const uint8_t* src = DataSource_peek(self, element, &available);
+    if(src == NULL) break;
+
+    if(available < op->length){
+      // the bitfield straddles two cache blocks
+      uint8_t bytes[8];
+      if(DataSource_read(self, element, bytes, op->length) != op->length) break;
+      dst[done++] = TypeOp_bits(op, bytes);
+      continue;
+    }
+
+    size_t n = (available - op->length)/stride + 1;
+    if(n > count - done) n = count - done;
+    gather_bits(dst + done, src, stride, n, op->length, op->shift, op->width);
+    done += n;
+  }
+  return done;
+}
+
+size_t gather_field(DataSource* source, TypeOp* op, size_t base, size_t stride,
+    size_t first, size_t count, void* dst){
+  // dynamic fields move around from record to record, they have no column
+  if(type_kinds[op->kind].dynamic) return 0;
+  size_t offset = base + first*stride + op->offset;
+  if(op->kind == Type_BITS){
+    return DataSource_gather_bits(source, dst, offset, stride, count, op);
+  }
+  if(op->kind == Type_CHAR_ARRAY){
+    return DataSource_gather(source, dst, offset, stride, count, op->length, false);
+  }
+  if(!TypeKind_is_primitive(op->kind)) return 0;
+  return DataSource_gather(source, dst, offset, stride, count, op->length, type_kinds[op->kind].swap);
+}
@@ -0,0 +1,44 @@
+#ifndef GATHER_H_
+#define GATHER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "data_source.h"
+#include "type.h"
+
+// copies count elements of size bytes that lie stride bytes apart in src
+// into the contiguous dst, byte swapping every element when swap is set.
+// Dispatches at runtime to the widest kernel the cpu supports
+void gather(void* dst, const uint8_t* src, size_t stride, size_t count, size_t size, bool swap);
+
+// extracts count bitfields of width bits starting at bit shift of the length
+// byte little endian words stride bytes apart, uses bmi2 when the cpu has it
+void gather_bits(uint64_t* dst, const uint8_t* src, size_t stride, size_t count,
+    size_t length, size_t shift, size_t width);
+
+// name of the kernel gather dispatches to, for logging. Picks the one of
+// gather_bits as well, so calling it before workers start keeps them from
+// racing on either
+const char* gather_kernel_name(void);
+
+// gather over the source, records straddling a cache block are copied one
+// by one, returns the number of elements gathered
+size_t DataSource_gather(DataSource* self, void* dst, size_t offset, size_t stride,
+    size_t count, size_t size, bool swap);
+
+// bytes per element of the columns of op
+size_t gather_field_size(TypeOp* op);
+
+// gathers field op of count records in memory, src points at the field of
+// the first record
+void gather_op(TypeOp* op, void* dst, const uint8_t* src, size_t stride, size_t count);
+
+// gathers field op of records [first, first+count) of an array of records
+// starting at base, numbers end up in host byte order, bitfields as u64 and
+// char arrays are copied as they are
+size_t gather_field(DataSource* source, TypeOp* op, size_t base, size_t stride,
+    size_t first, size_t count, void* dst);
+
+#endif // GATHER_H_
@@ -0,0 +1,320 @@
+#include "nob.h"
+
+#include "varint.h"
+#include "layout.h"
+
+// window over the data that dynamic fields are decoded from, refilled with
+// DataSource_read on the ui thread and DataSource_scan everywhere else
+typedef struct{
+  DataSource* source;
+  bool scan;
+  uint8_t* buffer;
+  size_t capacity;
+  const uint8_t* bytes;
+  size_t offset;
+  size_t size;
+} RecordReader;
+
+// bytes at offset, at least want of them unless the data ends first
+static const uint8_t* RecordReader_at(RecordReader* self, size_t offset, size_t want, size_t* got){
+  size_t window_end = self->offset + self->size;
+  bool inside = self->bytes != NULL && offset >= self->offset && offset <= window_end;
+  if(!inside || (window_end - offset < want && window_end < self->source->count)){
+    self->offset = offset;
+    if(self->scan){
+      self->bytes = DataSource_scan(self->source, offset, self->capacity, self->buffer, &self->size);
+    }else{
+      self->size = DataSource_read(self->source, offset, self->buffer, self->capacity);
+      self->bytes = self->buffer;
+    }
+    if(self->bytes == NULL) self->size = 0;
+  }
+  *got = self->offset + self->size - offset;
+  return self->bytes + (offset - self->offset);
+}
+
+static size_t TypeProgram_walk(TypeProgram* program, RecordReader* reader, size_t offset,
+    size_t* fields, size_t* lengths){
+  // bytes the dynamic fields take beyond their smallest encoding
+  size_t extra = 0;
+  for(size_t i = 0; i < program->count; ++i){
+    TypeOp* op = &program->items[i];
+    size_t at = op->offset + extra;
+    if(!op->dynamic){
+      if(fields != NULL){
+        fields[i] = at;
+        lengths[i] = op->length;
+      }
+      continue;
+    }
+
+    size_t got = 0;
+    if(fields == NULL && op->run > 1){
+      // only the size is needed, a whole run of varints is skipped at once
+      size_t run = op->run < LAYOUT_VARINT_RUN ? op->run : LAYOUT_VARINT_RUN;
+      uint64_t values[LAYOUT_VARINT_RUN];
+      const uint8_t* bytes = RecordReader_at(reader, offset + at, run*VARINT_MAX_BYTES, &got);
+      size_t used = 0;
+      if(varint_decode_run(bytes, got, values, run, &used) != run) return 0;
+      extra += used - run;
+      i += run-1;
+      continue;
+    }
+
+    const uint8_t* bytes = RecordReader_at(reader, offset + at, VARINT_MAX_BYTES, &got);
+    uint64_t value;
+    size_t length = varint_decode(bytes, got, &value);
+    if(length == 0) return 0;
+    if(op->kind == Type_BLOB){
+      size_t left = reader->source->count - (offset + at + length);
+      if(value > left) return 0;
+      length += value;
+    }
+    if(fields != NULL){
+      fields[i] = at;
+      lengths[i] = length;
+    }
+    extra += length - op->length;
+  }
+
+  size_t size = program->size + extra;
+  if(offset > reader->source->count || size > reader->source->count - offset) return 0;
+  return size;
+}
+
+size_t TypeProgram_measure(TypeProgram* program, DataSource* source, size_t offset,
+    size_t* fields, size_t* lengths){
+  uint8_t buffer[LAYOUT_VARINT_RUN*VARINT_MAX_BYTES];
+  RecordReader reader = {
+    .source = source,
+    .buffer = buffer,
+    .capacity = sizeof(buffer),
+  };
+  return TypeProgram_walk(program, &reader, offset, fields, lengths);
+}
+
+RecordLayout* LayoutCache_get(LayoutCache* self, TypeProgram* program, DataSource* source,
+    size_t offset, size_t generation){
+  self->tick++;
+  RecordLayout* victim = &self->items[0];
+  for(size_t i = 0; i < LAYOUT_CACHE_CAPACITY; ++i){
+    RecordLayout* layout = &self->items[i];
+    if(layout->valid && layout->offset == offset && layout->root == program->root
+        && layout->type_edits == program->type_edits && layout->generation == generation){
+      layout->last_used = self->tick;
+      return layout;
+    }
+    if(!layout->valid || layout->last_used < victim->last_used) victim = layout;
+  }
+
+  if(victim->capacity < program->count){
+    victim->capacity = program->count;
+    victim->fields = realloc(victim->fields, victim->capacity*sizeof(*victim->fields));
+    victim->lengths = realloc(victim->lengths, victim->capacity*sizeof(*victim->lengths));
+    NOB_ASSERT(victim->fields != NULL && victim->lengths != NULL && "Buy more RAM lol");
+  }
+  victim->valid = false;
+  victim->size = TypeProgram_measure(program, source, offset, victim->fields, victim->lengths);
+  if(victim->size == 0 && program->size > 0) return NULL;
+
+  victim->offset = offset;
+  victim->root = program->root;
+  victim->type_edits = program->type_edits;
+  victim->generation = generation;
+  victim->last_used = self->tick;
+  victim->valid = true;
+  return victim;
+}
+
+void LayoutCache_free(LayoutCache* self){
+  for(size_t i = 0; i < LAYOUT_CACHE_CAPACITY; ++i){
+    free(self->items[i].fields);
+    free(self->items[i].lengths);
+  }
+  memset(self, 0, sizeof(*self));
+}
+
+void RecordIndex_init(RecordIndex* self){
+  memset(self, 0, sizeof(*self));
+  self->complete = true;
+  pthread_mutex_init(&self->lock, NULL);
+}
+
+void RecordIndex_destroy(RecordIndex* self, ThreadPool* pool){
+  Job_cancel(pool, &self->job);
+  TypeProgram_free(&self->program);
+  nob_da_free(self->checkpoints);
+  nob_da_free(self->deltas);
+  pthread_mutex_destroy(&self->lock);
+  memset(self, 0, sizeof(*self));
+}
+
+// records the next record, the lock must be held
+static void RecordIndex_append(RecordIndex* self, size_t size){
+  if(self->count%RECORD_INDEX_STRIDE == 0){
+    RecordCheckpoint checkpoint = {
+      .offset = self->end,
+      .delta = self->deltas.count,
+    };
+    nob_da_append(&self->checkpoints, checkpoint);
+  }
+  nob_da_reserve(&self->deltas, self->deltas.count + VARINT_MAX_BYTES);
+  self->deltas.count += varint_encode(size, self->deltas.items + self->deltas.count);
+  self->end += size;
+  self->count++;
+}
+
+static void RecordIndex_run(Job* job, size_t chunk){
+  (void)chunk;
+  RecordIndex* self = (RecordIndex*)job;
+  uint8_t* buffer = NULL;
+  if(self->source->kind != DataSource_MMAP){
+    buffer = malloc(RECORD_INDEX_WINDOW);
+    if(buffer == NULL) return;
+  }
+  RecordReader reader = {
+    .source = self->source,
+    .scan = true,
+    .buffer = buffer,
+    .capacity = RECORD_INDEX_WINDOW,
+  };
+
+  // nobody else appends, so the walk can go on from the last record unlocked
+  size_t end = self->end;
+  size_t count = self->count;
+  bool complete = false;
+  while(!complete && !Job_is_cancelled(job)){
+    size_t sizes[RECORD_INDEX_BATCH];
+    size_t n = 0;
+    for(; n < RECORD_INDEX_BATCH; ++n){
+      if(self->limit != 0 && count + n >= self->limit){
+        complete = true;
+        break;
+      }
+      size_t size = TypeProgram_walk(&self->program, &reader, end, NULL, NULL);
+      if(size == 0){
+        complete = true;
+        break;
+      }
+      sizes[n] = size;
+      end += size;
+    }
+    count += n;
+
+    pthread_mutex_lock(&self->lock);
+    for(size_t i = 0; i < n; ++i) RecordIndex_append(self, sizes[i]);
+    self->complete = complete;
+    pthread_mutex_unlock(&self->lock);
+  }
+  free(buffer);
+}
+
+bool RecordIndex_sync(RecordIndex* self, ThreadPool* pool, TypeProgram* program, DataSource* source,
+    size_t base, size_t limit, size_t generation){
+  if(self->root == program->root && self->type_edits == program->type_edits
+      && self->base == base && self->limit == limit && self->generation == generation){
+    return !Job_is_done(&self->job);
+  }
+  Job_cancel(pool, &self->job);
+
+  pthread_mutex_lock(&self->lock);
+  self->checkpoints.count = 0;
+  self->deltas.count = 0;
+  self->count = 0;
+  self->end = base;
+  self->complete = program->root == NULL || program->size == 0 || base >= source->count;
+  pthread_mutex_unlock(&self->lock);
+
+  self->source = source;
+  self->root = program->root;
+  self->type_edits = program->type_edits;
+  self->base = base;
+  self->limit = limit;
+  self->generation = generation;
+  self->program.count = 0;
+  nob_da_append_many(&self->program, program->items, program->count);
+  self->program.size = program->size;
+  self->program.dynamic = program->dynamic;
+  self->program.root = program->root;
+  self->program.type_edits = program->type_edits;
+  if(self->complete || !pool->running) return false;
+  // resolved here so the worker never races on it
+  varint_kernel_name();
+
+  self->job.run = RecordIndex_run;
+  self->job.chunks = 1;
+  ThreadPool_submit(pool, &self->job);
+  return true;
+}
+
+size_t RecordIndex_count(RecordIndex* self){
+  pthread_mutex_lock(&self->lock);
+  size_t count = self->count;
+  pthread_mutex_unlock(&self->lock);
+  return count;
+}
+
+bool RecordIndex_is_complete(RecordIndex* self){
+  pthread_mutex_lock(&self->lock);
+  bool complete = self->complete;
+  pthread_mutex_unlock(&self->lock);
+  return complete;
+}
+
+float RecordIndex_progress(RecordIndex* self){
+  pthread_mutex_lock(&self->lock);
+  float progress = 1;
+  if(!self->complete && self->source != NULL && self->source->count > self->base){
+    progress = (float)(self->end - self->base)/(self->source->count - self->base);
+  }
+  pthread_mutex_unlock(&self->lock);
+  return progress;
+}
+
+// sizes of the records from checkpoint on, at most RECORD_INDEX_STRIDE of
+// them, the lock must be held
+static size_t RecordIndex_sizes(RecordIndex* self, size_t checkpoint, uint64_t* sizes, size_t count){
+  size_t first = checkpoint*RECORD_INDEX_STRIDE;
+  if(count > self->count - first) count = self->count - first;
+  size_t delta = self->checkpoints.items[checkpoint].delta;
+  size_t used = 0;
+  return varint_decode_run(self->deltas.items + delta, self->deltas.count - delta, sizes, count, &used);
+}
+
+size_t RecordIndex_offset(RecordIndex* self, size_t record){
+  pthread_mutex_lock(&self->lock);
+  NOB_ASSERT(record < self->count);
+  size_t checkpoint = record/RECORD_INDEX_STRIDE;
+  size_t offset = self->checkpoints.items[checkpoint].offset;
+  uint64_t sizes[RECORD_INDEX_STRIDE];
+  size_t n = RecordIndex_sizes(self, checkpoint, sizes, record%RECORD_INDEX_STRIDE);
+  for(size_t i = 0; i < n; ++i) offset += sizes[i];
+  pthread_mutex_unlock(&self->lock);
+  return offset;
+}
+
+size_t RecordIndex_find(RecordIndex* self, size_t offset){
+  pthread_mutex_lock(&self->lock);
+  size_t record = self->count;
+  if(self->count > 0 && self->checkpoints.items[0].offset <= offset){
+    size_t low = 0;
+    size_t high = self->checkpoints.count;
+    while(high - low > 1){
+      size_t mid = low + (high-low)/2;
+      if(self->checkpoints.items[mid].offset <= offset) low = mid;
+      else high = mid;
+    }
+
+    uint64_t sizes[RECORD_INDEX_STRIDE];
+    size_t n = RecordIndex_sizes(self, low, sizes, RECORD_INDEX_STRIDE);
+    size_t start = self->checkpoints.items[low].offset;
+    size_t i = 0;
+    while(i+1 < n && start + sizes[i] <= offset){
+      start += sizes[i];
+      i++;
+    }
+    record = low*RECORD_INDEX_STRIDE + i;
+  }
+  pthread_mutex_unlock(&self->lock);
+  return record;
+}
@@ -0,0 +1,123 @@
+#ifndef LAYOUT_H_
+#define LAYOUT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "data_source.h"
+#include "thread_pool.h"
+#include "type.h"
+
+// consecutive varints decoded in one go while walking records
+#define LAYOUT_VARINT_RUN 16
+
+// walks the instance of program at offset and returns its size, 0 when a
+// dynamic field is malformed or the instance runs past the end of the data.
+// fields and lengths receive the offset within the instance and the size of
+// every op when they are not NULL
+size_t TypeProgram_measure(TypeProgram* program, DataSource* source, size_t offset,
+    size_t* fields, size_t* lengths);
+
+// where the fields of one instance ended up, these only differ from the
+// compiled offsets when the program has dynamic ops
+typedef struct{
+  size_t offset;
+  size_t size;
+  size_t* fields;
+  size_t* lengths;
+  size_t capacity;
+
+  // what the layout was computed for
+  Type* root;
+  size_t type_edits;
+  size_t generation;
+  size_t last_used;
+  bool valid;
+} RecordLayout;
+
+#ifndef LAYOUT_CACHE_CAPACITY
+#define LAYOUT_CACHE_CAPACITY 256
+#endif // LAYOUT_CACHE_CAPACITY
+
+// layouts of the instances that were looked at recently, so the visible
+// records are walked once and not every frame
+typedef struct{
+  RecordLayout items[LAYOUT_CACHE_CAPACITY];
+  size_t tick;
+} LayoutCache;
+
+// layout of the instance of program at offset, NULL when it does not parse.
+// The layout stays valid until the next call
+RecordLayout* LayoutCache_get(LayoutCache* self, TypeProgram* program, DataSource* source,
+    size_t offset, size_t generation);
+void LayoutCache_free(LayoutCache* self);
+
+// a checkpoint keeps the start of every RECORD_INDEX_STRIDE-th record, the
+// records in between are found by adding up their sizes
+#ifndef RECORD_INDEX_STRIDE
+#define RECORD_INDEX_STRIDE 64
+#endif // RECORD_INDEX_STRIDE
+
+// records walked between handing them over to the ui
+#define RECORD_INDEX_BATCH 4096
+// bytes of the data a background walk reads at once
+#define RECORD_INDEX_WINDOW (1024*1024)
+
+typedef struct{
+  size_t offset; // start of the record
+  size_t delta;  // where the sizes of it and the records after it begin in deltas
+} RecordCheckpoint;
+
+// start of every record of an array of dynamically sized records. The records
+// are walked once on a pool in the background and kept as checkpoints plus the
+// varint encoded size of every record, about a byte or two per record, so
+// finding a record by number or by offset never walks more than
+// RECORD_INDEX_STRIDE sizes
+typedef struct{
+  Job job;
+  DataSource* source;
+  TypeProgram program; // copy of the ops, the overlay may recompile at any time
+
+  pthread_mutex_t lock; // guards everything below
+  struct{
+    RecordCheckpoint* items;
+    size_t count;
+    size_t capacity;
+  } checkpoints;
+  struct{
+    uint8_t* items;
+    size_t count;
+    size_t capacity;
+  } deltas;
+  size_t count;
+  size_t end;     // start of the next record to walk
+  bool complete;  // reached the end of the data, the limit or a bad record
+
+  // what the index is built for
+  Type* root;
+  size_t type_edits;
+  size_t base;
+  size_t limit;   // 0 means no limit
+  size_t generation;
+} RecordIndex;
+
+void RecordIndex_init(RecordIndex* self);
+void RecordIndex_destroy(RecordIndex* self, ThreadPool* pool);
+
+// starts over in the background when anything the index is built for changed,
+// returns true while the walk is still running
+bool RecordIndex_sync(RecordIndex* self, ThreadPool* pool, TypeProgram* program, DataSource* source,
+    size_t base, size_t limit, size_t generation);
+// records found so far
+size_t RecordIndex_count(RecordIndex* self);
+bool RecordIndex_is_complete(RecordIndex* self);
+// fraction of the data after base that was walked
+float RecordIndex_progress(RecordIndex* self);
+// start of record, which must be below the count
+size_t RecordIndex_offset(RecordIndex* self, size_t record);
+// last record starting at or before offset, RecordIndex_count when there is none
+size_t RecordIndex_find(RecordIndex* self, size_t offset);
+
+#endif // LAYOUT_H_
@@ -5,8 +5,25 @@
 #include "nhl.h"
 
 #include <raylib.h>
+#include <rlgl.h>
+
+#include "data_source.h"
+#include "prefetch.h"
+#include "type.h"
+#include "gather.h"
+#include "column_cache.h"
+#include "thread_pool.h"
+#include "stats.h"
+#include "layout.h"
+#include "byte_regex.h"
+#include "search.h"
+#include "signature.h"
 
 typedef struct{
+  const char* file_path;
+  size_t memory_budget;
+  bool continuous;
+  const char* signatures_path;
   char pad[1024];
 } App;
 
@@ -166,9 +183,90 @@ typedef enum{
 typedef struct{
   Align align;
 } LabelOpts;
+typedef struct{
+  uint64_t hash;
+  float size;
+  float spacing;
+  Vector2 measure;
+  size_t generation; // frame the entry was last used in, 0 when empty
+} TextMeasure;
+
+#define TEXT_CACHE_CAPACITY 4096
+#define TEXT_CACHE_MAX_AGE 120
+
+// the ui is immediate mode, so the same strings get measured every frame
+static struct{
+  TextMeasure items[TEXT_CACHE_CAPACITY];
+  size_t count;
+  size_t generation;
+} text_cache = { .generation = 1 };
+
+static uint64_t text_hash(const char* text){
+  uint64_t hash = 14695981039346656037llu;
+  for(; *text; ++text){
+    hash ^= (uint8_t)*text;
+    hash *= 1099511628211llu;
+  }
+  return hash;
+}
+
+static TextMeasure* text_cache_find(uint64_t hash, float size, float spacing){
+  size_t i = hash & (TEXT_CACHE_CAPACITY-1);
+  while(text_cache.items[i].generation != 0){
+    TextMeasure* it = &text_cache.items[i];
+    if(it->hash == hash && it->size == size && it->spacing == spacing) return it;
+    i = (i+1) & (TEXT_CACHE_CAPACITY-1);
+  }
+  return &text_cache.items[i];
+}
+
+Vector2 measure_text(const char* text, float size, float spacing){
+  uint64_t hash = text_hash(text);
+  TextMeasure* it = text_cache_find(hash, size, spacing);
+  if(it->generation != 0){
+    it->generation = text_cache.generation;
+    return it->measure;
+  }
+
+  Vector2 measure = MeasureTextEx(GetFontDefault(), text, size, spacing);
+  // keep the table sparse so probes stay short, past that just measure
+  if(text_cache.count < TEXT_CACHE_CAPACITY/2){
+    *it = (TextMeasure){
+      .hash = hash,
+      .size = size,
+      .spacing = spacing,
+      .measure = measure,
+      .generation = text_cache.generation,
+    };
+    text_cache.count++;
+  }
+  return measure;
+}
+
+// drop entries that have not been used for a while, called once per frame
+void text_cache_end_frame(void){
+  text_cache.generation++;
+  if(text_cache.generation % TEXT_CACHE_MAX_AGE != 0) return;
+
+  static TextMeasure live[TEXT_CACHE_CAPACITY];
+  size_t count = 0;
+  for(size_t i = 0; i < TEXT_CACHE_CAPACITY; ++i){
+    TextMeasure* it = &text_cache.items[i];
+    if(it->generation != 0 && text_cache.generation - it->generation < TEXT_CACHE_MAX_AGE){
+      live[count++] = *it;
+    }
+  }
+  memset(text_cache.items, 0, sizeof(text_cache.items));
+  text_cache.count = 0;
+  for(size_t i = 0; i < count; ++i){
+    *text_cache_find(live[i].hash, live[i].size, live[i].spacing) = live[i];
+    text_cache.count++;
+  }
+}
+
 #define label(rect, text, ...) label_opt((rect), (text), (LabelOpts){__VA_ARGS__})
 void label_opt(Rectangle rect, const char* text, LabelOpts opts){
-  Vector2 size = MeasureTextEx(GetFontDefault(), text, style.text.size, style.text.spacing);
+  Vector2 size = measure_text(text, style.text.size, style.text.spacing);
 
   Rectangle text_rect = {
     rect.x + (rect.width/2-size.x/2),
@@ -220,70 +318,96 @@ bool button_opt(Rectangle rect, const char* text, ButtonOpts opts){
   return hover(rect) && IsMouseButtonReleased(MOUSE_LEFT_BUTTON);
 }
 
-typedef enum{
-  Type_STRUCT = 0,
-  Type_INT,
-  Type_FLOAT,
-  Type_CHAR_ARRAY,
-} TypeKind;
-
-typedef struct Type Type;
-struct Type{
-  TypeKind kind;
-  Type* parent;
-  size_t id;
-  union{
-    struct{
-      Type* items;
-      size_t count;
-      size_t capacity;
-    } Struct;
-    struct{
-      size_t count;
-    } Array;
-  } as;
-};
-
+// single line of text edited while it has the focus, clicking it takes the
+// focus and clicking anywhere else drops it
 typedef struct{
-  Type* items;
-  size_t count;
-  size_t capacity;
-} TypeArray;
+  char text[256];
+  size_t length;
+  bool focused;
+} TextInput;
 
-static TypeArray type_arena = {0};
-static TypeArray current_struct = {0};
+// returns true when enter was pressed while focused
+bool text_input(Rectangle rect, TextInput* self){
+  if(hover(rect)){
+    SetMouseCursor(MOUSE_CURSOR_IBEAM);
+    mouse_cursor_set = true;
+  }
+  if(IsMouseButtonReleased(MOUSE_LEFT_BUTTON)) self->focused = hover(rect);
 
-void Struct_remove(Type* self, size_t i){
-  if(self->kind != Type_STRUCT) return;
-  if(i < self->as.Struct.count-1){
-    memcpy(
-        self->as.Struct.items+i, 
-        self->as.Struct.items+i+1, 
-        self->as.Struct.count-i-1);
+  bool submitted = false;
+  if(self->focused){
+    int c;
+    while((c = GetCharPressed()) != 0){
+      if(c >= ' ' && c <= '~' && self->length+1 < sizeof(self->text)){
+        self->text[self->length++] = c;
+        self->text[self->length] = '\0';
+      }
+    }
+    if((IsKeyPressed(KEY_BACKSPACE) || IsKeyPressedRepeat(KEY_BACKSPACE)) && self->length > 0){
+      self->text[--self->length] = '\0';
+    }
+    submitted = IsKeyPressed(KEY_ENTER);
   }
-  self->as.Struct.count--;
+
+  int padding = 2;
+  DrawRectangleRec(rect, style.button.up.background);
+  DrawRectangleLinesEx(rect, style.button.border.size, self->focused ? style.text.color : style.button.border.color);
+  label(rect_offset(rect, -padding*2), self->focused ? nob_temp_sprintf("%s_", self->text) : self->text,
+      .align = Align_LEFT);
+  return submitted;
 }
 
-void Struct_add(Type* self, Type child){
-  child.parent = self;
-  child.id = self->as.Struct.count;
-  nob_da_append(&self->as.Struct, child);
+// vertical scrollbar over total rows of which visible are shown from first
+// on, clicking or dragging in the track jumps straight to that position.
+// Returns true when first changed
+bool scrollbar(Rectangle rect, size_t* first, size_t visible, size_t total){
+  DrawRectangleRec(rect, style.button.up.background);
+  if(total <= visible) return false;
+  float thumb_height = rect.height*visible/total;
+  if(thumb_height < 8) thumb_height = 8;
+  float track = rect.height - thumb_height;
+  size_t last = total - visible;
+  Rectangle thumb = rect;
+  thumb.height = thumb_height;
+  thumb.y += track*(*first < last ? *first : last)/last;
+  DrawRectangleRec(thumb, hover(rect) ? style.button.hover.background : style.button.border.color);
+
+  if(!hover(rect) || !IsMouseButtonDown(MOUSE_LEFT_BUTTON)) return false;
+  float at = (GetMouseY() - rect.y - thumb_height/2)/track;
+  if(at < 0) at = 0;
+  if(at > 1) at = 1;
+  size_t picked = at*last;
+  bool changed = picked != *first;
+  *first = picked;
+  return changed;
 }
 
-size_t Type_sizeof(Type* self){
-  switch (self->kind) {
-    case Type_INT: return 4;
-    case Type_FLOAT: return 4;
-    case Type_CHAR_ARRAY: return self->as.Array.count;
-    case Type_STRUCT:{
-      size_t size = 0;
-      for(size_t i = 0; i < self->as.Struct.count; ++i){
-        size += Type_sizeof(&self->as.Struct.items[i]);
-      }
-      return size;
-    };
+// parses a whole decimal number out of a text input
+bool TextInput_number(TextInput* self, size_t* value){
+  char* end;
+  unsigned long long x = strtoull(self->text, &end, 10);
+  if(self->length == 0 || *end != '\0' || self->text[0] == '-') return false;
+  *value = x;
+  return true;
+}
+
+void TextInput_set(TextInput* self, const char* text){
+  snprintf(self->text, sizeof(self->text), "%s", text);
+  self->length = strlen(self->text);
+}
+
+Color Type_color(Type* self){
+  if(self->kind == Type_STRUCT) return GREEN;
+  if(self->kind == Type_CHAR_ARRAY) return PURPLE;
+  if(self->kind == Type_BITS) return ORANGE;
+  if(self->kind == Type_BLOB) return MAROON;
+  switch(type_kinds[self->kind].class){
+    case TypeClass_SIGNED: return BLUE;
+    case TypeClass_UNSIGNED: return SKYBLUE;
+    case TypeClass_FLOAT: return YELLOW;
+    case TypeClass_NONE: break;
   }
-  return 0;
+  return GRAY;
 }
 
 static Type* dragging_type = NULL;
@@ -310,89 +434,137 @@ void Type_render(Rectangle rect, Type* self, void* buffer){
 
       //DrawRectangleRec(sub_rect, ColorAlpha(GREEN, 0.2));
       //DrawRectangleLinesEx(sub_rect, 2, GREEN);
-      size_t offset = 0;
-      for(size_t i = 0; i < self->as.Struct.count; ++i){
-        type_size = Type_sizeof(&self->as.Struct.items[i]);
-        sub_rect = rect_table_cell(rect, cols, rows, 0, offset, .height=type_size);
+      Type* child = Type_first(self);
+      while(child != NULL){
+        // rendering the child may remove it, so step ahead first
+        Type* next = Type_next(child);
+        size_t offset = Type_offsetof(child);
+        sub_rect = rect_table_cell(rect, cols, rows, 0, offset, .height=Type_sizeof(child));
+        if(child->kind == Type_BITS && Type_sizeof(child) == 1){
+          // bitfields within a single byte share its row by bit position
+          sub_rect.x += sub_rect.width*child->as.Bits.shift/8;
+          sub_rect.width *= child->as.Bits.width/8.0f;
+        }
         void* offset_buffer = buffer == NULL ? NULL : buffer + offset;
-        Type_render(sub_rect, &self->as.Struct.items[i], offset_buffer);
-        offset += type_size;
+        Type_render(sub_rect, child, offset_buffer);
+        child = next;
       }
+      size_t offset = type_size;
       if(buffer != NULL || self == dragging_type) return;
 
       sub_rect = rect_table_cell(rect, cols, rows, 0, offset, .height=1);
       static bool add_type = false;
+      static bool add_big_endian = false;
+      // one row per family of primitives, the byte order applies to all
+      static const TypeKind add_kinds[][4] = {
+        { Type_I8, Type_I16, Type_I32, Type_I64 },
+        { Type_U8, Type_U16, Type_U32, Type_U64 },
+        { Type_F16, Type_F32, Type_F64 },
+      };
       if(!add_type && button(sub_rect, "+")){
         add_type = true;
       }else if(add_type){
+        for(size_t row = 0; row < NOB_ARRAY_LEN(add_kinds); ++row){
+          offset++;
+          sub_rect = rect_table_cell(rect, cols, rows, 0, offset, .height=1);
+          for(size_t col = 0; col < NOB_ARRAY_LEN(add_kinds[row]); ++col){
+            TypeKind kind = add_kinds[row][col];
+            if(kind == Type_STRUCT) continue;
+            kind = TypeKind_with_order(kind, add_big_endian);
+            if(button(rect_table_cell(sub_rect, 4, 1, col, 0), type_kinds[kind].name)){
+              Struct_add(self, ((Type){
+                .kind = kind,
+              }));
+              add_type = false;
+            }
+          }
+        }
         offset++;
         sub_rect = rect_table_cell(rect, cols, rows, 0, offset, .height=1);
-        if(button(sub_rect, "Int")){
-          Struct_add(self, ((Type){
-            .kind = Type_INT,
-          }));
-          add_type = false;
+        if(button(sub_rect, add_big_endian ? "Big endian" : "Little endian")){
+          add_big_endian = !add_big_endian;
         }
         offset++;
         sub_rect = rect_table_cell(rect, cols, rows, 0, offset, .height=1);
-        if(button(sub_rect, "Float")){
+        if(button(rect_table_cell(sub_rect, 2, 1, 0, 0), "Char[]")){
           Struct_add(self, ((Type){
-            .kind = Type_FLOAT,
+            .kind = Type_CHAR_ARRAY,
           }));
           add_type = false;
         }
-        offset++;
-        sub_rect = rect_table_cell(rect, cols, rows, 0, offset, .height=1);
-        if(button(sub_rect, "Char[]")){
+        if(button(rect_table_cell(sub_rect, 2, 1, 1, 0), "Bits")){
           Struct_add(self, ((Type){
-            .kind = Type_CHAR_ARRAY,
+            .kind = Type_BITS,
+            .as.Bits.width = 1,
           }));
           add_type = false;
         }
         offset++;
         sub_rect = rect_table_cell(rect, cols, rows, 0, offset, .height=1);
+        static const TypeKind dynamic_kinds[] = { Type_VARINT, Type_SVARINT, Type_BLOB };
+        for(size_t i = 0; i < NOB_ARRAY_LEN(dynamic_kinds); ++i){
+          if(button(rect_table_cell(sub_rect, NOB_ARRAY_LEN(dynamic_kinds), 1, i, 0), type_kinds[dynamic_kinds[i]].name)){
+            Struct_add(self, ((Type){
+              .kind = dynamic_kinds[i],
+            }));
+            add_type = false;
+          }
+        }
+        offset++;
+        sub_rect = rect_table_cell(rect, cols, rows, 0, offset, .height=1);
         if(button(sub_rect, "Cancel")){
           add_type = false;
         }
       }
     }break;
-    case Type_INT:{
-      DrawRectangleRec(sub_rect, ColorAlpha(BLUE, 0.2));
-      DrawRectangleLinesEx(sub_rect, 2, BLUE);
+    default:{
+      const TypeKindInfo* info = &type_kinds[self->kind];
+      DrawRectangleRec(sub_rect, ColorAlpha(Type_color(self), 0.2));
+      DrawRectangleLinesEx(sub_rect, 2, Type_color(self));
       if(buffer == NULL){
-        label(sub_rect, "Int");
+        label(sub_rect, info->name);
         if(hover(sub_rect) && button(rect_table_cell(sub_rect, 3, type_size, 0, 0), "x")){
-          Struct_remove(self->parent, self->id);
+          Struct_remove(Type_parent(self), self);
         }
+      }else if(info->dynamic){
+        label(sub_rect, info->name);
       }else{
-        label(sub_rect, nob_temp_sprintf("Int: %d", *(int*)buffer));
+        label(sub_rect, nob_temp_sprintf("%s: %s", info->name, info->format(info->load(buffer))));
       }
     }break;
-    case Type_FLOAT:{
-      DrawRectangleRec(sub_rect, ColorAlpha(YELLOW, 0.2));
-      DrawRectangleLinesEx(sub_rect, 2, YELLOW);
+    case Type_BITS:{
+      DrawRectangleRec(sub_rect, ColorAlpha(Type_color(self), 0.2));
+      DrawRectangleLinesEx(sub_rect, 2, Type_color(self));
+      size_t width = self->as.Bits.width;
       if(buffer == NULL){
-        label(sub_rect, "Float");
-        if(hover(sub_rect) && button(rect_table_cell(sub_rect, 3, type_size, 0, 0), "x")){
-          Struct_remove(self->parent, self->id);
+        label(sub_rect, nob_temp_sprintf("b%zu", width));
+        if(hover(sub_rect)){
+          if(button(rect_table_cell(sub_rect, 3, type_size, 0, 0), "x")){
+            Struct_remove(Type_parent(self), self);
+          }else if(button(rect_table_cell(sub_rect, 3, type_size, 1, 0), "-")){
+            Bits_set_width(self, width-1);
+          }else if(button(rect_table_cell(sub_rect, 3, type_size, 2, 0), "+")){
+            Bits_set_width(self, width+1);
+          }
         }
       }else{
-        label(sub_rect, nob_temp_sprintf("Float: %f", *(float*)buffer));
+        TypeOp op = { .length = type_size, .shift = self->as.Bits.shift, .width = width, .kind = Type_BITS };
+        label(sub_rect, nob_temp_sprintf("b%zu: %llu", width, (unsigned long long)TypeOp_bits(&op, buffer)));
       }
     }break;
     case Type_CHAR_ARRAY:{
-      DrawRectangleRec(sub_rect, ColorAlpha(PURPLE, 0.2));
-      DrawRectangleLinesEx(sub_rect, 2, PURPLE);
+      DrawRectangleRec(sub_rect, ColorAlpha(Type_color(self), 0.2));
+      DrawRectangleLinesEx(sub_rect, 2, Type_color(self));
       if(buffer == NULL){
-        if(self->as.Array.count <= 0) self->as.Array.count = 1;
+        if(self->as.Array.count <= 0) Array_set_count(self, 1);
         label(sub_rect, nob_temp_sprintf("Char[%lu]", self->as.Array.count));
         if(hover(sub_rect) && button(rect_table_cell(sub_rect, 3, type_size, 0, 0), "x")){
-          Struct_remove(self->parent, self->id);
+          Struct_remove(Type_parent(self), self);
         }
-        if(button(rect_table_cell(sub_rect, 8, type_size, 7, 0), "+")) 
-          self->as.Array.count++;
+        if(button(rect_table_cell(sub_rect, 8, type_size, 7, 0), "+"))
+          Array_set_count(self, self->as.Array.count+1);
         if(button(rect_table_cell(sub_rect, 8, type_size, 6, 0), "-"))
-          self->as.Array.count--;
+          Array_set_count(self, self->as.Array.count-1);
       }else{
         label(sub_rect, nob_temp_sprintf("Char[%lu]: %.*s",
               self->as.Array.count, self->as.Array.count, (char*)buffer));
@@ -401,6 +573,850 @@ void Type_render(Rectangle rect, Type* self, void* buffer){
   }
 }
 
+typedef struct{
+  Rectangle offsets;
+  Rectangle hex;
+  Rectangle ascii;
+  size_t cols;
+  size_t rows;
+  size_t first_row;
+  int offset_digits;
+  float row_height;
+  float cell_width;
+  float char_width;
+} HexLayout;
+
+HexLayout HexLayout_make(Rectangle rect, size_t data_size){
+  int padding = 2;
+  HexLayout layout = {0};
+  layout.row_height = style.text.size+padding*2;
+  // whole pixels, so cells line up with the glyph atlas
+  layout.cell_width = (int)measure_text("FF", style.text.size, style.text.spacing).x + 1 + padding*4;
+  layout.char_width = (int)measure_text("W", style.text.size, style.text.spacing).x + 1;
+  layout.offset_digits = data_size > 0xFFFFFFFFFFFFllu ? 16 : data_size > 0xFFFFFFFFllu ? 12 : 8;
+
+  float offsets_width = measure_text(nob_temp_sprintf("%0*X", layout.offset_digits, 0),
+      style.text.size, style.text.spacing).x + padding*4;
+
+  // widest power of two that fits, so offsets stay easy to read
+  float available = rect.width - offsets_width - padding*4;
+  layout.cols = 32;
+  while(layout.cols > 1 && layout.cols*(layout.cell_width+layout.char_width) > available){
+    layout.cols /= 2;
+  }
+  layout.rows = rect.height/layout.row_height + 1;
+
+  Split split = rect_split(rect, .horizontal_px = offsets_width);
+  layout.offsets = split.left;
+  split = rect_split(split.right, .horizontal_px = layout.cols*layout.cell_width + padding*2);
+  layout.hex = split.left;
+  layout.ascii = split.right;
+  layout.ascii.x += padding*2;
+  layout.ascii.width = layout.cols*layout.char_width;
+  return layout;
+}
+
+Rectangle HexLayout_cell(HexLayout* self, size_t i){
+  return (Rectangle){
+    self->hex.x + (i%self->cols)*self->cell_width,
+    self->hex.y + ((long)(i/self->cols) - (long)self->first_row)*self->row_height,
+    self->cell_width, self->row_height,
+  };
+}
+
+Rectangle HexLayout_char(HexLayout* self, size_t i){
+  return (Rectangle){
+    self->ascii.x + (i%self->cols)*self->char_width,
+    self->ascii.y + ((long)(i/self->cols) - (long)self->first_row)*self->row_height,
+    self->char_width, self->row_height,
+  };
+}
+
+bool HexLayout_hit(HexLayout* self, Vector2 point, size_t data_size, size_t* i){
+  float col;
+  if(CheckCollisionPointRec(point, self->hex)){
+    col = (point.x - self->hex.x)/self->cell_width;
+  }else if(CheckCollisionPointRec(point, self->ascii)){
+    col = (point.x - self->ascii.x)/self->char_width;
+  }else{
+    return false;
+  }
+  size_t row = self->first_row + (size_t)((point.y - self->hex.y)/self->row_height);
+  if(col >= self->cols) return false;
+  *i = row*self->cols + (size_t)col;
+  return *i < data_size;
+}
+
+// highlight the visible part of [begin, end) in both the hex and ascii pane,
+// one rectangle per row
+void HexLayout_tint(HexLayout* self, size_t begin, size_t end, Color color){
+  size_t visible_begin = self->first_row*self->cols;
+  size_t visible_end = (self->first_row+self->rows)*self->cols;
+  if(begin < visible_begin) begin = visible_begin;
+  if(end > visible_end) end = visible_end;
+
+  while(begin < end){
+    size_t row_end = (begin/self->cols + 1)*self->cols;
+    if(row_end > end) row_end = end;
+    Rectangle first = HexLayout_cell(self, begin);
+    Rectangle last = HexLayout_cell(self, row_end-1);
+    first.width = last.x + last.width - first.x;
+    DrawRectangleRec(first, color);
+    first = HexLayout_char(self, begin);
+    last = HexLayout_char(self, row_end-1);
+    first.width = last.x + last.width - first.x;
+    DrawRectangleRec(first, color);
+    begin = row_end;
+  }
+}
+
+void HexLayout_render_frame(HexLayout* self, size_t data_size){
+  DrawRectangleRec(self->offsets, style.button.up.background);
+  DrawRectangleRec(self->hex, style.background);
+  DrawRectangleRec(self->ascii, style.background);
+
+  for(size_t row = 0; row < self->rows; ++row){
+    size_t offset = (self->first_row+row)*self->cols;
+    if(offset >= data_size) break;
+    Rectangle rect = self->offsets;
+    rect.y += row*self->row_height;
+    rect.height = self->row_height;
+    label(rect, nob_temp_sprintf("%0*zX", self->offset_digits, offset));
+  }
+}
+
+// every byte value pre-rasterized once, both as hex cell and as ascii cell,
+// so the visible bytes can be drawn as quads from a single texture
+typedef struct{
+  RenderTexture2D texture;
+  float cell_width;
+  float char_width;
+  float height;
+} GlyphAtlas;
+
+static GlyphAtlas glyph_atlas = {0};
+
+void GlyphAtlas_unload(GlyphAtlas* self){
+  if(self->texture.id != 0) UnloadRenderTexture(self->texture);
+  *self = (GlyphAtlas){0};
+}
+
+Rectangle GlyphAtlas_hex(GlyphAtlas* self, uint8_t byte){
+  return (Rectangle){ (byte%16)*self->cell_width, (byte/16)*self->height, self->cell_width, self->height };
+}
+
+Rectangle GlyphAtlas_char(GlyphAtlas* self, uint8_t byte){
+  return (Rectangle){ 16*self->cell_width + (byte%16)*self->char_width, (byte/16)*self->height, self->char_width, self->height };
+}
+
+void GlyphAtlas_update(GlyphAtlas* self, HexLayout* layout){
+  if(self->texture.id != 0
+      && self->cell_width == layout->cell_width
+      && self->char_width == layout->char_width
+      && self->height == layout->row_height
+  ) return;
+
+  GlyphAtlas_unload(self);
+  self->cell_width = layout->cell_width;
+  self->char_width = layout->char_width;
+  self->height = layout->row_height;
+  self->texture = LoadRenderTexture(16*(self->cell_width+self->char_width), 16*self->height);
+  SetTextureFilter(self->texture.texture, TEXTURE_FILTER_POINT);
+
+  // glyphs are baked in white and tinted when drawn
+  Font font = GetFontDefault();
+  int padding = 2;
+  BeginTextureMode(self->texture);
+  ClearBackground(BLANK);
+  for(int i = 0; i < 256; ++i){
+    char text[3];
+    snprintf(text, sizeof(text), "%02X", i);
+    Rectangle slot = GlyphAtlas_hex(self, i);
+    DrawTextEx(font, text, (Vector2){ slot.x + padding*2, slot.y + padding },
+        style.text.size, style.text.spacing, WHITE);
+    text[0] = i >= 0x20 && i < 0x7F ? i : '.';
+    text[1] = '\0';
+    slot = GlyphAtlas_char(self, i);
+    DrawTextEx(font, text, (Vector2){ slot.x, slot.y + padding },
+        style.text.size, style.text.spacing, WHITE);
+  }
+  EndTextureMode();
+}
+
+static void GlyphAtlas_quad(GlyphAtlas* self, Rectangle src, Rectangle dst){
+  float width = self->texture.texture.width;
+  float height = self->texture.texture.height;
+  // render textures are stored upside down
+  float u0 = src.x/width, u1 = (src.x+src.width)/width;
+  float v0 = 1 - src.y/height, v1 = 1 - (src.y+src.height)/height;
+  rlTexCoord2f(u0, v0); rlVertex2f(dst.x, dst.y);
+  rlTexCoord2f(u0, v1); rlVertex2f(dst.x, dst.y+dst.height);
+  rlTexCoord2f(u1, v1); rlVertex2f(dst.x+dst.width, dst.y+dst.height);
+  rlTexCoord2f(u1, v0); rlVertex2f(dst.x+dst.width, dst.y);
+}
+
+// draws the glyphs of the visible part of [begin, end), the glyph atlas has to
+// be up to date with the layout
+void HexLayout_render_bytes(HexLayout* self, DataSource* source, size_t begin, size_t end){
+  size_t visible_begin = self->first_row*self->cols;
+  size_t visible_end = (self->first_row+self->rows)*self->cols;
+  if(visible_begin < begin) visible_begin = begin;
+  if(visible_end > end) visible_end = end;
+  if(visible_end > source->count) visible_end = source->count;
+
+  rlSetTexture(glyph_atlas.texture.texture.id);
+  rlBegin(RL_QUADS);
+  rlColor4ub(style.text.color.r, style.text.color.g, style.text.color.b, style.text.color.a);
+
+  const uint8_t* bytes = NULL;
+  size_t bytes_left = 0;
+  for(size_t i = visible_begin; i < visible_end; ++i){
+    if(bytes_left == 0) bytes = DataSource_peek(source, i, &bytes_left);
+    if(bytes == NULL) break;
+    uint8_t byte = *bytes++;
+    bytes_left--;
+
+    rlCheckRenderBatchLimit(8);
+    GlyphAtlas_quad(&glyph_atlas, GlyphAtlas_hex(&glyph_atlas, byte), HexLayout_cell(self, i));
+    GlyphAtlas_quad(&glyph_atlas, GlyphAtlas_char(&glyph_atlas, byte), HexLayout_char(self, i));
+  }
+
+  rlEnd();
+  rlSetTexture(0);
+}
+
+// draws the decoded fields of the instance whose first size bytes are in
+// buffer, one row per byte like Type_render. A layout places the fields
+// when the program has dynamic ops, NULL uses the offsets of the ops
+void TypeProgram_render(Rectangle rect, TypeProgram* self, const uint8_t* buffer, size_t size, RecordLayout* layout){
+  int padding = 2;
+  int row_height = style.text.size+padding*2;
+  int rows = rect.height/row_height;
+  if(rows <= 0) return;
+
+  for(size_t i = 0; i < self->count; ++i){
+    TypeOp* op = &self->items[i];
+    size_t offset = layout == NULL ? op->offset : layout->fields[i];
+    size_t length = layout == NULL ? op->length : layout->lengths[i];
+    if(offset >= size) break;
+    Rectangle sub_rect = rect_table_cell(rect, 1, rows, 0, offset, .height = length);
+    DrawRectangleRec(sub_rect, ColorAlpha(Type_color(op->type), 0.2));
+    DrawRectangleLinesEx(sub_rect, 2, Type_color(op->type));
+    size_t available = length < size - offset ? length : size - offset;
+    label(sub_rect, nob_temp_sprintf("%s: %s", TypeOp_name(op), TypeOp_format_raw(op, buffer + offset, available)));
+  }
+}
+
+// a Type placed on the data, either once or repeated as an array of records
+typedef struct{
+  Type* type;
+  TypeProgram program;
+  size_t offset;
+  bool repeat;
+  size_t stride; // 0 means the size of the type
+  size_t count;  // 0 means until the end of the data
+  // where the records are when their size depends on the data
+  RecordIndex index;
+} Overlay;
+
+// bytes of a dynamic field read to show its value
+#define OVERLAY_PREVIEW_SIZE 64
+
+static size_t data_generation = 0;
+static LayoutCache layouts = {0};
+static ThreadPool pool = {0};
+
+void Overlay_update(Overlay* self){
+  TypeProgram_update(&self->program, self->type);
+}
+
+bool Overlay_is_dynamic(Overlay* self){
+  return self->program.dynamic > 0;
+}
+
+// keeps the index of an array of dynamic records in sync with the overlay,
+// returns true while it is being built in the background
+bool Overlay_index(Overlay* self, DataSource* source){
+  if(!self->repeat || !Overlay_is_dynamic(self)) return false;
+  return RecordIndex_sync(&self->index, &pool, &self->program, source, self->offset, self->count, data_generation);
+}
+
+size_t Overlay_stride(Overlay* self){
+  if(!self->repeat || Overlay_is_dynamic(self)) return self->program.size;
+  return self->stride == 0 ? self->program.size : self->stride;
+}
+
+size_t Overlay_record(Overlay* self, size_t record){
+  if(self->repeat && Overlay_is_dynamic(self)) return RecordIndex_offset(&self->index, record);
+  return self->offset + record*Overlay_stride(self);
+}
+
+size_t Overlay_count(Overlay* self, size_t data_size){
+  if(self->type == NULL || self->program.size == 0 || self->offset >= data_size) return 0;
+  if(self->repeat && Overlay_is_dynamic(self)) return RecordIndex_count(&self->index);
+  size_t stride = Overlay_stride(self);
+  size_t fit = self->offset + self->program.size > data_size
+    ? 0 : (data_size - self->offset - self->program.size)/stride + 1;
+  if(!self->repeat) return fit > 0 ? 1 : 0;
+  if(self->count != 0 && self->count < fit) return self->count;
+  return fit;
+}
+
+// tints the records that intersect the visible part of the layout, records
+// alternate in strength so their boundaries stay visible
+void Overlay_tint(Overlay* self, HexLayout* layout, DataSource* source){
+  size_t count = Overlay_count(self, source->count);
+  if(count == 0) return;
+  size_t stride = Overlay_stride(self);
+  size_t visible_begin = layout->first_row*layout->cols;
+  size_t visible_end = (layout->first_row+layout->rows)*layout->cols;
+  if(visible_end <= self->offset) return;
+
+  if(Overlay_is_dynamic(self)){
+    size_t first = self->repeat ? RecordIndex_find(&self->index, visible_begin) : 0;
+    if(first >= count) first = 0;
+    for(size_t r = first; r < count; ++r){
+      size_t offset = Overlay_record(self, r);
+      if(offset >= visible_end) break;
+      RecordLayout* record = LayoutCache_get(&layouts, &self->program, source, offset, data_generation);
+      if(record == NULL) break;
+      for(size_t i = 0; i < self->program.count; ++i){
+        TypeOp* op = &self->program.items[i];
+        HexLayout_tint(layout, offset+record->fields[i], offset+record->fields[i]+record->lengths[i],
+            ColorAlpha(Type_color(op->type), r%2 == 0 ? 0.4 : 0.25));
+      }
+    }
+    return;
+  }
+
+  size_t first = visible_begin > self->offset ? (visible_begin - self->offset)/stride : 0;
+  // records may be longer than the stride, so start at the first that can reach in
+  size_t overlap = (self->program.size + stride-1)/stride;
+  first = first > overlap ? first - overlap : 0;
+  size_t last = (visible_end - self->offset)/stride + 1;
+  if(last > count) last = count;
+
+  for(size_t r = first; r < last; ++r){
+    size_t offset = self->offset + r*stride;
+    for(size_t i = 0; i < self->program.count; ++i){
+      TypeOp* op = &self->program.items[i];
+      HexLayout_tint(layout, offset+op->offset, offset+op->offset+op->length,
+          ColorAlpha(Type_color(op->type), r%2 == 0 ? 0.4 : 0.25));
+    }
+  }
+}
+
+static SearchJob search_job = {0};
+static SignatureSet signatures = {0};
+static ByteRegex regex = {0};
+// bumped whenever a new search starts, so tiles showing old hits are dropped
+static size_t search_generation = 0;
+// hit the hit list is at, SIZE_MAX before one was picked
+static size_t search_current = SIZE_MAX;
+
+Color SearchHit_color(SearchHit* hit){
+  if(search_job.kind == SearchKind_SIGNATURES) return ColorFromHSV((hit->id*47)%360, 0.6, 1.0);
+  if(search_job.kind == SearchKind_VALUES) return SKYBLUE;
+  if(search_job.kind == SearchKind_REGEX) return LIME;
+  return YELLOW;
+}
+
+// highlights the hits that intersect the visible part of the layout
+void search_tint(HexLayout* layout){
+  size_t visible_begin = layout->first_row*layout->cols;
+  size_t visible_end = (layout->first_row+layout->rows)*layout->cols;
+  // hits starting before the view may still reach into it
+  size_t begin = visible_begin >= search_job.overlap ? visible_begin - search_job.overlap : 0;
+  SearchHit hits[1024];
+  size_t count = SearchJob_range(&search_job, begin, visible_end, hits, NOB_ARRAY_LEN(hits));
+  for(size_t i = 0; i < count; ++i){
+    HexLayout_tint(layout, hits[i].offset, hits[i].offset + hits[i].length, ColorAlpha(SearchHit_color(&hits[i]), 0.35));
+  }
+}
+
+#define HEX_TILE_ROWS 16
+#define HEX_TILE_COUNT 12
+
+typedef struct{
+  size_t first_row;
+  size_t cols;
+  float cell_width;
+  float char_width;
+  float row_height;
+  float width;
+  Type* overlay;
+  size_t overlay_edits;
+  size_t overlay_offset;
+  size_t overlay_stride;
+  size_t overlay_count;
+  size_t data_generation;
+  size_t search_generation;
+  size_t search_hits; // hits that may reach into the tile
+  bool search_running;
+} HexTileKey;
+
+// HEX_TILE_ROWS rows of the hex and ascii panes rendered once and then
+// composited every frame until anything that shows up in them changes
+typedef struct{
+  RenderTexture2D texture;
+  HexTileKey key;
+  size_t last_used;
+  bool valid;
+} HexTile;
+
+static HexTile hex_tiles[HEX_TILE_COUNT] = {0};
+static size_t hex_tiles_frame = 0;
+
+void HexTile_unload_all(void){
+  for(size_t i = 0; i < HEX_TILE_COUNT; ++i){
+    if(hex_tiles[i].texture.id != 0) UnloadRenderTexture(hex_tiles[i].texture);
+    hex_tiles[i] = (HexTile){0};
+  }
+}
+
+static HexTile* HexTile_get(HexTileKey* key){
+  HexTile* victim = &hex_tiles[0];
+  for(size_t i = 0; i < HEX_TILE_COUNT; ++i){
+    HexTile* tile = &hex_tiles[i];
+    if(tile->valid && memcmp(&tile->key, key, sizeof(*key)) == 0){
+      tile->last_used = hex_tiles_frame;
+      return tile;
+    }
+    if(!tile->valid || tile->last_used < victim->last_used) victim = tile;
+  }
+  victim->valid = false;
+  return victim;
+}
+
+static void HexTile_render(HexTile* tile, HexLayout* layout, DataSource* source, Overlay* overlay){
+  int width = tile->key.width;
+  int height = HEX_TILE_ROWS*layout->row_height;
+  if(tile->texture.id == 0 || tile->texture.texture.width != width || tile->texture.texture.height != height){
+    if(tile->texture.id != 0) UnloadRenderTexture(tile->texture);
+    tile->texture = LoadRenderTexture(width, height);
+  }
+
+  // same layout, moved so the first row of the tile is at the origin
+  HexLayout local = *layout;
+  local.first_row = tile->key.first_row;
+  local.rows = HEX_TILE_ROWS;
+  local.ascii.x -= local.hex.x;
+  local.ascii.y = 0;
+  local.hex.x = 0;
+  local.hex.y = 0;
+
+  BeginTextureMode(tile->texture);
+    ClearBackground(style.background);
+    Overlay_tint(overlay, &local, source);
+    search_tint(&local);
+    HexLayout_render_bytes(&local, source, 0, source->count);
+  EndTextureMode();
+
+  tile->valid = true;
+  tile->last_used = hex_tiles_frame;
+}
+
+// draws the hex and ascii panes from cached tiles, only tiles that scrolled
+// into view or whose contents changed get rendered again
+void HexLayout_render_tiles(HexLayout* self, DataSource* source, Overlay* overlay){
+  hex_tiles_frame++;
+
+  HexTileKey key;
+  memset(&key, 0, sizeof(key));
+  key.cols = self->cols;
+  key.cell_width = self->cell_width;
+  key.char_width = self->char_width;
+  key.row_height = self->row_height;
+  key.width = self->ascii.x + self->ascii.width - self->hex.x;
+  key.overlay = overlay->type;
+  key.overlay_edits = overlay->program.type_edits;
+  key.overlay_offset = overlay->offset;
+  key.overlay_stride = Overlay_stride(overlay);
+  key.overlay_count = Overlay_count(overlay, source->count);
+  key.data_generation = data_generation;
+  key.search_generation = search_generation;
+  // while hits stream in only the tiles they land in are rendered again
+  key.search_running = search_job.running;
+
+  size_t total_rows = (source->count + self->cols-1)/self->cols;
+  size_t first_tile = self->first_row/HEX_TILE_ROWS;
+  size_t last_tile = (self->first_row+self->rows)/HEX_TILE_ROWS;
+
+  // tiles are rendered before any of them is composited, render textures
+  // must not be drawn into while the scissor is active
+  HexTile* visible[HEX_TILE_COUNT];
+  size_t visible_count = 0;
+  for(size_t t = first_tile; t <= last_tile && t*HEX_TILE_ROWS < total_rows && visible_count < HEX_TILE_COUNT; ++t){
+    key.first_row = t*HEX_TILE_ROWS;
+    size_t tile_begin = key.first_row*self->cols;
+    size_t tile_end = tile_begin + HEX_TILE_ROWS*self->cols;
+    size_t reach = tile_begin >= search_job.overlap ? tile_begin - search_job.overlap : 0;
+    key.search_hits = SearchJob_count_range(&search_job, reach, tile_end);
+    HexTile* tile = HexTile_get(&key);
+    if(!tile->valid){
+      tile->key = key;
+      HexTile_render(tile, self, source, overlay);
+    }
+    visible[visible_count++] = tile;
+  }
+
+  BeginScissorMode(self->hex.x, self->hex.y, key.width, self->hex.height);
+  for(size_t i = 0; i < visible_count; ++i){
+    HexTile* tile = visible[i];
+    Rectangle src = { 0, 0, tile->texture.texture.width, -tile->texture.texture.height };
+    Vector2 position = {
+      self->hex.x,
+      self->hex.y + ((long)tile->key.first_row - (long)self->first_row)*self->row_height,
+    };
+    DrawTextureRec(tile->texture.texture, src, position, WHITE);
+  }
+  EndScissorMode();
+}
+
+static ColumnCache columns = { .budget = COLUMN_CACHE_DEFAULT_BUDGET };
+static StatsJob stats_job = {0};
+
+// field of the overlay the stats are shown for, 0 when none
+static TypeId stats_field = 0;
+static struct{
+  TypeId field;
+  size_t base;
+  size_t stride;
+  size_t count;
+  size_t type_edits;
+  size_t data_generation;
+} stats_key = {0};
+
+// summary of a field on the left, histogram on the right, shows whatever
+// the job merged so far
+void stats_panel(Rectangle rect, StatsJob* job, TypeOp* op){
+  Stats stats;
+  StatsJob_result(job, &stats);
+
+  Split split = rect_split(rect, .horizontal=0.4);
+  const char* lines[] = {
+    nob_temp_sprintf("%s", TypeOp_name(op)),
+    nob_temp_sprintf("count: %zu", stats.count),
+    nob_temp_sprintf("min: %g", stats.count > 0 ? stats.min : 0),
+    nob_temp_sprintf("max: %g", stats.count > 0 ? stats.max : 0),
+    nob_temp_sprintf("mean: %g", stats.mean),
+    nob_temp_sprintf("stddev: %g", Stats_stddev(&stats)),
+    nob_temp_sprintf("distinct: ~%.0f", Stats_distinct(&stats)),
+    job->running
+      ? nob_temp_sprintf("%s %.0f%%", job->pass == 1 ? "scanning" : "binning", Job_progress(&job->job)*100)
+      : "done",
+  };
+  size_t line_count = NOB_ARRAY_LEN(lines);
+  for(size_t i = 0; i < line_count; ++i){
+    label(rect_table_cell(split.left, 1, line_count, 0, i), lines[i], .align = Align_LEFT);
+  }
+
+  if(!(stats.high > stats.low)) return;
+  size_t peak = 1;
+  for(size_t i = 0; i < STATS_HISTOGRAM_BINS; ++i){
+    if(stats.histogram[i] > peak) peak = stats.histogram[i];
+  }
+  Rectangle plot = rect_offset(split.right, -2);
+  float bar_width = plot.width/STATS_HISTOGRAM_BINS;
+  for(size_t i = 0; i < STATS_HISTOGRAM_BINS; ++i){
+    float height = plot.height*stats.histogram[i]/peak;
+    Rectangle bar = { plot.x + i*bar_width, plot.y + plot.height - height, bar_width, height };
+    DrawRectangleRec(bar, Type_color(op->type));
+  }
+  if(hover(plot)){
+    size_t i = (GetMouseX() - plot.x)/bar_width;
+    if(i >= STATS_HISTOGRAM_BINS) i = STATS_HISTOGRAM_BINS-1;
+    double bin_width = (stats.high - stats.low)/STATS_HISTOGRAM_BINS;
+    label(plot, nob_temp_sprintf("[%g, %g): %zu",
+          stats.low + i*bin_width, stats.low + (i+1)*bin_width, stats.histogram[i]), .align = Align_TOP);
+  }
+}
+
+// controls of the overlay followed by either the decoded fields of the single
+// instance or a table of the records, the table reads from the column cache.
+// Returns true and sets jump_to when a record was clicked
+bool overlay_inspector(Rectangle rect, Overlay* self, DataSource* source, size_t* jump_to){
+  int padding = 2;
+  float row_height = style.text.size+padding*2;
+  Split split = rect_split(rect, .vertical_px = row_height);
+  Rectangle bar = split.top;
+  rect = split.bottom;
+
+  if(button(rect_table_cell(bar, 8, 1, 0, 0, .width = 2), self->repeat ? "Array" : "Single")){
+    self->repeat = !self->repeat;
+  }
+  bool dynamic = Overlay_is_dynamic(self);
+  if(!self->repeat){
+    RecordLayout* record = NULL;
+    size_t size = self->program.size;
+    if(dynamic){
+      record = LayoutCache_get(&layouts, &self->program, source, self->offset, data_generation);
+      if(record == NULL) return false;
+      size = record->size;
+    }
+    if(self->offset + size > source->count) return false;
+    // only the start of huge blobs is of interest
+    if(size > 64*1024) size = 64*1024;
+    uint8_t* buffer = nob_temp_alloc(size);
+    DataSource_read(source, self->offset, buffer, size);
+    TypeProgram_render(rect, &self->program, buffer, size, record);
+    return false;
+  }
+
+  size_t stride = Overlay_stride(self);
+  size_t count = Overlay_count(self, source->count);
+  if(dynamic){
+    // the records are as long as their data says
+    label(rect_table_cell(bar, 8, 1, 2, 0, .width = 3), "dynamic");
+  }else{
+    if(button(rect_table_cell(bar, 8, 1, 2, 0), "-") && stride > 1) self->stride = stride-1;
+    label(rect_table_cell(bar, 8, 1, 3, 0), nob_temp_sprintf("%zu", stride));
+    if(button(rect_table_cell(bar, 8, 1, 4, 0), "+")) self->stride = stride+1;
+  }
+  // records up to the end of the data, or a count typed in
+  if(button(rect_table_cell(bar, 8, 1, 5, 0), self->count == 0 ? "[EOF]" : "EOF")){
+    self->count = self->count == 0 ? count : 0;
+  }
+  static TextInput count_input = {0};
+  Rectangle count_rect = rect_table_cell(bar, 8, 1, 6, 0, .width = 2);
+  if(self->count == 0){
+    count_input.focused = false;
+    if(dynamic && !RecordIndex_is_complete(&self->index)){
+      label(count_rect, nob_temp_sprintf("%zu %d%%", count, (int)(RecordIndex_progress(&self->index)*100)));
+    }else{
+      label(count_rect, nob_temp_sprintf("%zu", count));
+    }
+  }else{
+    if(!count_input.focused) TextInput_set(&count_input, nob_temp_sprintf("%zu", self->count));
+    size_t typed;
+    if(text_input(count_rect, &count_input) && TextInput_number(&count_input, &typed) && typed > 0){
+      self->count = typed;
+      count = Overlay_count(self, source->count);
+      count_input.focused = false;
+    }
+  }
+
+  static size_t first_record = 0;
+  size_t rows = rect.height/row_height;
+  if(rows < 2) return false;
+  rows--; // header
+  if(hover(rect)){
+    float wheel = GetMouseWheelMove();
+    size_t step = wheel > 0 ? wheel*3 : -wheel*3;
+    if(wheel > 0) first_record = step > first_record ? 0 : first_record-step;
+    if(wheel < 0) first_record += step;
+  }
+  if(first_record >= count) first_record = count > 0 ? count-1 : 0;
+
+  // numeric headers toggle the stats of their column below the table
+  TypeOp* stats_op = NULL;
+  for(size_t i = 0; i < self->program.count; ++i){
+    if(self->program.items[i].type->id == stats_field) stats_op = &self->program.items[i];
+  }
+  if(stats_op != NULL && !dynamic){
+    Split table = rect_split(rect, .vertical=0.6);
+    rect = table.top;
+    if(stats_key.field != stats_field || stats_key.base != self->offset || stats_key.stride != stride
+        || stats_key.count != count || stats_key.type_edits != type_edits
+        || stats_key.data_generation != data_generation){
+      stats_key.field = stats_field;
+      stats_key.base = self->offset;
+      stats_key.stride = stride;
+      stats_key.count = count;
+      stats_key.type_edits = type_edits;
+      stats_key.data_generation = data_generation;
+      StatsJob_start(&stats_job, &pool, source, stats_op, self->offset, stride, count);
+    }
+    StatsJob_update(&stats_job, &pool);
+    stats_panel(rect_offset(table.bottom, -padding), &stats_job, stats_op);
+    rows = rect.height/row_height;
+    if(rows < 2) return false;
+    rows--;
+  }else if(stats_job.running){
+    StatsJob_cancel(&stats_job, &pool);
+    stats_key.field = 0;
+  }
+
+  // the scrollbar covers the rows, the header is left to the columns
+  float scrollbar_width = 12;
+  Rectangle track = rect;
+  track.x += rect.width - scrollbar_width;
+  track.width = scrollbar_width;
+  track.y += row_height;
+  track.height = rows*row_height;
+  rect.width -= scrollbar_width;
+  scrollbar(track, &first_record, rows, count);
+
+  // index column and one column per field, typing a record number into the
+  // index header jumps to it
+  size_t cols = self->program.count + 1;
+  Rectangle header = rect;
+  header.height = row_height;
+  static TextInput record_input = {0};
+  Rectangle index_cell = rect_table_cell(header, cols, 1, 0, 0);
+  size_t typed;
+  if(text_input(index_cell, &record_input) && TextInput_number(&record_input, &typed)){
+    first_record = typed < count ? typed : count > 0 ? count-1 : 0;
+    record_input.focused = false;
+    TextInput_set(&record_input, "");
+  }
+  if(!record_input.focused && record_input.length == 0) label(index_cell, "#");
+  for(size_t i = 0; i < self->program.count; ++i){
+    TypeOp* op = &self->program.items[i];
+    Rectangle cell = rect_table_cell(header, cols, 1, i+1, 0);
+    if(dynamic || !Stats_decode(op, NULL, 0, NULL)){
+      label(cell, TypeOp_name(op));
+    }else if(button(cell, op == stats_op ? nob_temp_sprintf("[%s]", TypeOp_name(op)) : TypeOp_name(op))){
+      stats_field = op == stats_op ? 0 : op->type->id;
+    }
+  }
+
+  bool clicked = false;
+  ColumnCache_sync(&columns, data_generation);
+  for(size_t r = 0; r < rows && first_record+r < count; ++r){
+    size_t record = first_record+r;
+    size_t offset = Overlay_record(self, record);
+    Rectangle row = header;
+    row.y += (r+1)*row_height;
+    if(record%2 == 1) DrawRectangleRec(row, ColorAlpha(style.button.hover.background, 0.3));
+    if(hover(row)){
+      DrawRectangleLinesEx(row, 1, style.button.border.color);
+      if(IsMouseButtonReleased(MOUSE_LEFT_BUTTON) && dragging_type == NULL){
+        *jump_to = offset;
+        clicked = true;
+      }
+    }
+
+    label(rect_table_cell(row, cols, 1, 0, 0), nob_temp_sprintf("%zu", record));
+    if(dynamic){
+      // fields move around, so they are read through the layout of the record
+      RecordLayout* layout = LayoutCache_get(&layouts, &self->program, source, offset, data_generation);
+      if(layout == NULL) continue;
+      for(size_t i = 0; i < self->program.count; ++i){
+        TypeOp* op = &self->program.items[i];
+        size_t length = layout->lengths[i];
+        if(op->dynamic && length > OVERLAY_PREVIEW_SIZE) length = OVERLAY_PREVIEW_SIZE;
+        uint8_t* value = nob_temp_alloc(length);
+        length = DataSource_read(source, offset + layout->fields[i], value, length);
+        label(rect_table_cell(row, cols, 1, i+1, 0), TypeOp_format_raw(op, value, length));
+      }
+      continue;
+    }
+    for(size_t i = 0; i < self->program.count; ++i){
+      TypeOp* op = &self->program.items[i];
+      const uint8_t* value = ColumnCache_get(&columns, source, &self->program, op,
+          self->offset, stride, count, record, NULL);
+      if(value == NULL) continue;
+      label(rect_table_cell(row, cols, 1, i+1, 0), TypeOp_format_element(op, value));
+    }
+  }
+  return clicked;
+}
+
+static DataSource data = { .fd = -1 };
+static bool data_opened = false;
+static Prefetcher prefetcher = {0};
+static Overlay overlay = {0};
+static bool overlay_indexing = false;
+
+// pattern input and the hit list, hits stream in while the search runs.
+// The first step goes to the hit nearest to at, where the view is. Returns
+// true and sets jump_to when a hit was picked
+bool search_bar(Rectangle rect, DataSource* source, size_t at, size_t* jump_to){
+  static TextInput input = {0};
+  static char searched[sizeof(input.text)] = {0};
+  static bool invalid = false;
+  static bool searched_once = false;
+
+  if(IsKeyDown(KEY_LEFT_CONTROL) && IsKeyPressed(KEY_F)) input.focused = true;
+  SearchJob_update(&search_job);
+  size_t count = SearchJob_count(&search_job);
+
+  bool scan = signatures.states > 0;
+  bool submitted = text_input(rect_table_cell(rect, 8, 1, 0, 0, .width = scan ? 3 : 4), &input);
+  submitted |= button(rect_table_cell(rect, 8, 1, 4, 0), "Find");
+  int step = 0;
+  if(scan && button(rect_table_cell(rect, 8, 1, 3, 0), "Sigs")){
+    SearchJob_start_signatures(&search_job, &pool, source, &signatures);
+    nob_log(NOB_INFO, "search_bar: %zu signatures, %s kernel", signatures.count, signature_kernel_name());
+    invalid = false;
+    searched_once = true;
+    searched[0] = '\0';
+    search_generation++;
+    search_current = SIZE_MAX;
+    count = 0;
+  }else if(submitted && search_job.kind != SearchKind_SIGNATURES && strcmp(input.text, searched) == 0 && count > 0){
+    // searching for the same thing again moves on to the next hit
+    step = 1;
+  }else if(submitted){
+    SearchPattern pattern;
+    ValueQuery query;
+    invalid = false;
+    strcpy(searched, input.text);
+    searched_once = true;
+    if(SearchPattern_parse(&pattern, input.text)){
+      SearchJob_start(&search_job, &pool, source, &pattern);
+      nob_log(NOB_INFO, "search_bar: %zu byte pattern, %s kernel", pattern.length, search_kernel_name());
+    }else if(ValueQuery_parse(&query, input.text)){
+      SearchJob_start_values(&search_job, &pool, source, &query);
+      nob_log(NOB_INFO, "search_bar: %s values, %s kernel", type_kinds[query.kind].name,
+          query.range ? gather_kernel_name() : search_kernel_name());
+    }else{
+      // the running search may still use the old regex
+      SearchJob_cancel(&search_job, &pool);
+      ByteRegex_free(&regex);
+      invalid = !ByteRegex_compile(&regex, input.text);
+      if(!invalid){
+        SearchJob_start_regex(&search_job, &pool, source, &regex);
+        nob_log(NOB_INFO, "search_bar: regex with %zu byte classes, %zu states", regex.class_count, regex.forward.states);
+      }
+    }
+    search_generation++;
+    search_current = SIZE_MAX;
+    count = 0;
+  }
+  if(button(rect_table_cell(rect, 8, 1, 5, 0), "<")) step = -1;
+  if(button(rect_table_cell(rect, 8, 1, 7, 0), ">") || IsKeyPressed(KEY_F3)) step = 1;
+
+  Rectangle status = rect_table_cell(rect, 8, 1, 6, 0);
+  if(invalid){
+    label(status, "hex, \"text\", i32 == 1 or regex");
+  }else if(search_job.running){
+    label(status, nob_temp_sprintf("%zu %d%%", count, (int)(Job_progress(&search_job.job)*100)));
+  }else if(count > 0){
+    const char* more = SearchJob_is_truncated(&search_job) ? "+" : "";
+    const char* name = "";
+    if(search_current < count && search_job.kind == SearchKind_SIGNATURES){
+      name = nob_temp_sprintf(" %s", signatures.items[SearchJob_hit(&search_job, search_current).id].name);
+    }
+    label(status, search_current < count
+        ? nob_temp_sprintf("%zu/%zu%s%s", search_current+1, count, more, name)
+        : nob_temp_sprintf("%zu%s", count, more));
+  }else if(searched_once){
+    label(status, "none");
+  }
+
+  if(step == 0 || count == 0) return false;
+  if(search_current >= count){
+    size_t next = SearchJob_find(&search_job, at);
+    if(step > 0) search_current = next < count ? next : 0;
+    else search_current = next > 0 && next <= count ? next-1 : count-1;
+  }else{
+    search_current = step > 0 ? (search_current+1)%count : (search_current+count-1)%count;
+  }
+  *jump_to = SearchJob_hit(&search_job, search_current).offset;
+  return true;
+}
+
+// the current hit is drawn over the tiles, so moving through the hits does
+// not invalidate them
+void search_tint_current(HexLayout* layout, DataSource* source){
+  if(search_current >= SearchJob_count(&search_job)) return;
+  SearchHit hit = SearchJob_hit(&search_job, search_current);
+  HexLayout_tint(layout, hit.offset, hit.offset + hit.length, ColorAlpha(ORANGE, 0.6));
+  HexLayout_render_bytes(layout, source, hit.offset, hit.offset + hit.length);
+}
+
 void main_menu(void* ctx){
   App* app = ctx;
   
@@ -409,55 +1425,100 @@ void main_menu(void* ctx){
     GetScreenWidth(),GetScreenHeight()
   };
 
-  static Nob_String_Builder data = {0};
-  if(data.count == 0){
-    nob_read_entire_file("test.data", &data);
+  if(!data_opened){
+    data_opened = true;
+    data_generation++;
+    RecordIndex_init(&overlay.index);
+    if(DataSource_open(&data, app->file_path, app->memory_budget)){
+      nob_log(NOB_INFO, "main_menu: using %s gather kernel", gather_kernel_name());
+      Prefetcher_start(&prefetcher, &data);
+      ThreadPool_start(&pool, 0);
+      StatsJob_init(&stats_job);
+      SearchJob_init(&search_job);
+      if(app->signatures_path != NULL) SignatureSet_load(&signatures, app->signatures_path);
+    }
   }
 
-  Split split = rect_split(rect, .horizontal=0.5);
+  Split split = rect_split(rect, .horizontal=0.6);
 
   int padding = 2;
-  int row_height = style.text.size+padding*3;
-  int rows = split.left.height/row_height;
-  int cols = 1;
-  static Type* view_structure = NULL;
-  static Rectangle view_rect = {0};
-  static size_t view_offset = 0;
-  for(size_t i = 0; i < data.count; ++i){
-    Rectangle byte_rect = rect_table_cell(split.left, cols, rows, 0, i);
-    DrawRectangleRec(byte_rect, GRAY);
-    byte_rect = rect_offset(byte_rect, -1);
-    DrawRectangleRec(byte_rect, style.background);
-    byte_rect = rect_offset(byte_rect, -padding);
-    if(button(byte_rect, nob_temp_sprintf("%02X", data.items[i]), .align = Align_LEFT)
-        && dragging_type != NULL
-    ){
-      view_structure = dragging_type;
-      view_rect = dragging_rect;
-      view_rect.x = byte_rect.x;
-      view_rect.y = byte_rect.y;
-      view_offset = i;
-      nob_log(NOB_INFO, "view: x = %f, y = %f, w = %f, h = %f",
-          view_rect.x, view_rect.y, view_rect.width, view_rect.height);
+  Overlay_update(&overlay);
+  overlay_indexing = Overlay_index(&overlay, &data);
+
+  Split view = rect_split(split.left, .vertical_px = style.text.size+padding*4);
+  HexLayout layout = HexLayout_make(view.bottom, data.count);
+
+  // the scroll position is kept in bytes so it survives the column count
+  // changing when the window is resized
+  static size_t scroll_offset = 0;
+  static int scroll_direction = 1;
+  size_t search_hit = 0;
+  if(search_bar(rect_offset(view.top, -padding), &data, scroll_offset, &search_hit)){
+    scroll_offset = search_hit;
+  }
+  float wheel = hover(view.bottom) ? GetMouseWheelMove() : 0;
+  if(wheel != 0){
+    long scroll_rows = wheel*3;
+    if(scroll_rows == 0) scroll_rows = wheel > 0 ? 1 : -1;
+    scroll_direction = scroll_rows > 0 ? -1 : 1;
+    size_t scroll_bytes = labs(scroll_rows)*layout.cols;
+    if(scroll_rows > 0){
+      scroll_offset = scroll_bytes > scroll_offset ? 0 : scroll_offset-scroll_bytes;
+    }else if(scroll_offset + scroll_bytes < data.count){
+      scroll_offset += scroll_bytes;
     }
+  }
+  layout.first_row = scroll_offset/layout.cols;
+  Prefetcher_hint(&prefetcher, layout.first_row*layout.cols, layout.rows*layout.cols, scroll_direction);
+
+  HexLayout_render_frame(&layout, data.count);
+  GlyphAtlas_update(&glyph_atlas, &layout);
+
+  // only the rows that are on screen are visited, so the cost of a frame
+  // does not depend on the size of the file
+  HexLayout_render_tiles(&layout, &data, &overlay);
+  search_tint_current(&layout, &data);
 
+  size_t hovered = 0;
+  bool hovering = HexLayout_hit(&layout, GetMousePosition(), data.count, &hovered);
+  if(hovering){
+    // the hovered byte is drawn over the tiles, so hovering does not
+    // invalidate them
+    HexLayout_tint(&layout, hovered, hovered+1, style.button.hover.background);
+    HexLayout_render_bytes(&layout, &data, hovered, hovered+1);
+    SetMouseCursor(MOUSE_CURSOR_POINTING_HAND);
+    mouse_cursor_set = true;
+    if(dragging_type != NULL && IsMouseButtonReleased(MOUSE_LEFT_BUTTON)){
+      overlay.type = dragging_type;
+      overlay.offset = hovered;
+      Overlay_update(&overlay);
+      nob_log(NOB_INFO, "view: offset = %zu, size = %zu", overlay.offset, overlay.program.size);
+    }
   }
-  if(view_structure != NULL){
-    Type_render(rect_table_cell(split.left, cols, rows, 0, view_offset),view_structure, data.items+view_offset);
+
+  Split right = rect_split(split.right, .vertical=0.5);
+
+  // inspector
+  rect = rect_offset(right.bottom, -padding);
+  DrawRectangleRec(rect, DARKGRAY);
+  rect = rect_offset(rect, -padding);
+  if(overlay.type != NULL){
+    size_t jump_to = 0;
+    if(overlay_inspector(rect, &overlay, &data, &jump_to)){
+      scroll_offset = jump_to;
+    }
   }
 
   // struct menu
   
-  rect = rect_offset(split.right, -padding);
+  rect = rect_offset(right.top, -padding);
   DrawRectangleRec(rect, DARKGRAY);
   rect = rect_offset(rect, -padding);
 
-  static Type base_struct = {
-    .kind = Type_STRUCT,
-    .as.Struct = {0},
-  };
+  static Type* base_struct = NULL;
+  if(base_struct == NULL) base_struct = Type_new((Type){ .kind = Type_STRUCT });
 
-  Type_render(rect, &base_struct, NULL);  
+  Type_render(rect, base_struct, NULL);  
   
   if(dragging_type != NULL){
     dragging_rect.x = GetMouseX();
@@ -470,14 +1531,35 @@ void main_menu(void* ctx){
 
 void* nhl_init(int argc, char **argv){
   App* app = calloc(1,sizeof(App));
+  app->memory_budget = DATA_SOURCE_DEFAULT_BUDGET;
 
-  TestData test_data = {
-    .a = 12,
-    .b = 42,
-    .str = "Hello!"
-  };
+  nob_shift_args(&argc, &argv);
+  while(argc > 0){
+    const char* arg = nob_shift_args(&argc, &argv);
+    if(strncmp(arg, "--budget=", 9) == 0){
+      // memory budget in MiB, files larger than it go through the block cache
+      app->memory_budget = strtoull(arg+9, NULL, 10)*1024*1024;
+    }else if(strncmp(arg, "--signatures=", 13) == 0){
+      // list of magic numbers the Sigs button scans for in one pass
+      app->signatures_path = arg+13;
+    }else if(strcmp(arg, "--continuous") == 0){
+      // redraw every frame instead of waiting for input when idle
+      app->continuous = true;
+    }else{
+      app->file_path = arg;
+    }
+  }
 
-  nob_write_entire_file("test.data", &test_data, sizeof(TestData));
+  if(app->file_path == NULL){
+    TestData test_data = {
+      .a = 12,
+      .b = 42,
+      .str = "Hello!"
+    };
+
+    nob_write_entire_file("test.data", &test_data, sizeof(TestData));
+    app->file_path = "test.data";
+  }
 
   SetConfigFlags(FLAG_WINDOW_RESIZABLE);
   InitWindow(800, 600, "Hexcaster");
@@ -485,12 +1567,52 @@ void* nhl_init(int argc, char **argv){
   return app;
 }
 
+// true while something is animating or changing under the user, in which
+// case frames are produced at the full frame rate
+bool ui_is_busy(void){
+  if(dragging_type != NULL) return true;
+  if(IsMouseButtonDown(MOUSE_LEFT_BUTTON) || IsMouseButtonDown(MOUSE_RIGHT_BUTTON)) return true;
+  if(GetMouseWheelMove() != 0) return true;
+  if(IsWindowResized()) return true;
+  // keep frames coming while background jobs report progress
+  if(stats_job.running) return true;
+  if(search_job.running) return true;
+  if(overlay_indexing) return true;
+  return false;
+}
+
+// when idle EndDrawing blocks until the next input event instead of redrawing
+// at 60 FPS, every event is followed by one extra frame so state changed by
+// the immediate mode ui during the first one gets drawn as well. Note that a
+// hot reload is only picked up after the next event while waiting
+void ui_update_idle(App* app){
+  static int pending_frames = 0;
+  static bool waiting = false;
+
+  if(app->continuous || ui_is_busy()){
+    pending_frames = 2;
+  }else if(waiting){
+    pending_frames = 1;
+  }else if(pending_frames > 0){
+    pending_frames--;
+  }
+
+  bool wait = pending_frames == 0;
+  if(wait != waiting){
+    if(wait) EnableEventWaiting();
+    else DisableEventWaiting();
+    waiting = wait;
+  }
+}
+
 bool nhl_update(void* ctx){
   BeginDrawing();
     ClearBackground(GRAY);
     main_menu(ctx);
+    ui_update_idle(ctx);
   EndDrawing();
   nob_temp_reset();
+  text_cache_end_frame();
   if(!mouse_cursor_set){
     SetMouseCursor(MOUSE_CURSOR_DEFAULT);
   }
@@ -499,7 +1621,22 @@ bool nhl_update(void* ctx){
 }
 
 void nhl_pre_reload(void* ctx){
-  
+  // statics don't survive the reload, release the mapping while we still can
+  // and make sure no thread is left running code that is about to be unloaded
+  Prefetcher_stop(&prefetcher);
+  StatsJob_destroy(&stats_job, &pool);
+  SearchJob_destroy(&search_job, &pool);
+  SignatureSet_free(&signatures);
+  ByteRegex_free(&regex);
+  RecordIndex_destroy(&overlay.index, &pool);
+  ThreadPool_stop(&pool);
+  DataSource_close(&data);
+  data_opened = false;
+  GlyphAtlas_unload(&glyph_atlas);
+  HexTile_unload_all();
+  TypeProgram_free(&overlay.program);
+  LayoutCache_free(&layouts);
+  ColumnCache_free(&columns);
 }
 
 void nhl_post_reload(void* ctx){
@@ -507,6 +1644,15 @@ void nhl_post_reload(void* ctx){
 }
 
 void nhl_destroy(void* ctx){
-
+  Prefetcher_stop(&prefetcher);
+  StatsJob_destroy(&stats_job, &pool);
+  SearchJob_destroy(&search_job, &pool);
+  SignatureSet_free(&signatures);
+  ByteRegex_free(&regex);
+  RecordIndex_destroy(&overlay.index, &pool);
+  ThreadPool_stop(&pool);
+  DataSource_close(&data);
+  LayoutCache_free(&layouts);
+  ColumnCache_free(&columns);
 }
 
@@ -0,0 +1,122 @@
+#include "nob.h"
+
+#include <unistd.h>
+
+#include "prefetch.h"
+
+static bool Prefetcher_is_stale(Prefetcher* self, size_t generation){
+  pthread_mutex_lock(&self->lock);
+  bool stale = !self->running || self->generation != generation;
+  pthread_mutex_unlock(&self->lock);
+  return stale;
+}
+
+static void Prefetcher_fetch(Prefetcher* self, size_t offset, size_t step){
+  DataSource* source = self->source;
+  switch(source->kind){
+    case DataSource_MMAP:{
+      // start the kernel readahead, then fault the pages in on this thread
+      DataSource_will_need(source, offset, step);
+      size_t end = offset+step < source->count ? offset+step : source->count;
+      size_t page_size = sysconf(_SC_PAGESIZE);
+      for(size_t i = offset; i < end; i += page_size){
+        (void)*(volatile const uint8_t*)(source->items+i);
+      }
+    }break;
+    case DataSource_CACHED:{
+      BlockCache_prefetch(&source->cache, offset);
+    }break;
+  }
+}
+
+static void* Prefetcher_run(void* arg){
+  Prefetcher* self = arg;
+  size_t seen = 0;
+
+  for(;;){
+    pthread_mutex_lock(&self->lock);
+    while(self->running && self->generation == seen){
+      pthread_cond_wait(&self->wake, &self->lock);
+    }
+    if(!self->running){
+      pthread_mutex_unlock(&self->lock);
+      break;
+    }
+    seen = self->generation;
+    size_t offset = self->offset;
+    size_t size = self->size;
+    int direction = self->direction;
+    pthread_mutex_unlock(&self->lock);
+
+    DataSource* source = self->source;
+    size_t step = source->kind == DataSource_CACHED ? BLOCK_CACHE_BLOCK_SIZE : 64*1024;
+    size_t ahead = size*PREFETCH_SCREENS;
+    if(source->kind == DataSource_CACHED){
+      // never read ahead so far that we evict what is currently on screen
+      size_t limit = source->cache.count/2*BLOCK_CACHE_BLOCK_SIZE;
+      if(ahead > limit) ahead = limit;
+    }
+
+    // the visible range first, then outward in the direction of travel
+    size_t begin = offset - offset%step;
+    size_t end = offset+size;
+    for(size_t i = begin; i < end && i < source->count; i += step){
+      if(Prefetcher_is_stale(self, seen)) break;
+      Prefetcher_fetch(self, i, step);
+    }
+    if(direction >= 0){
+      for(size_t i = end - end%step; i < end+ahead && i < source->count; i += step){
+        if(Prefetcher_is_stale(self, seen)) break;
+        Prefetcher_fetch(self, i, step);
+      }
+    }else{
+      size_t stop = begin > ahead ? begin-ahead : 0;
+      for(size_t i = begin; i > stop; i -= step){
+        if(Prefetcher_is_stale(self, seen)) break;
+        Prefetcher_fetch(self, i-step, step);
+      }
+    }
+  }
+  return NULL;
+}
+
+bool Prefetcher_start(Prefetcher* self, DataSource* source){
+  *self = (Prefetcher){
+    .source = source,
+    .running = true,
+  };
+  pthread_mutex_init(&self->lock, NULL);
+  pthread_cond_init(&self->wake, NULL);
+  if(pthread_create(&self->thread, NULL, Prefetcher_run, self) != 0){
+    nob_log(NOB_ERROR, "Prefetcher_start: could not start prefetch thread");
+    pthread_mutex_destroy(&self->lock);
+    pthread_cond_destroy(&self->wake);
+    self->running = false;
+    return false;
+  }
+  return true;
+}
+
+void Prefetcher_stop(Prefetcher* self){
+  if(!self->running) return;
+  pthread_mutex_lock(&self->lock);
+  self->running = false;
+  pthread_cond_signal(&self->wake);
+  pthread_mutex_unlock(&self->lock);
+  pthread_join(self->thread, NULL);
+  pthread_mutex_destroy(&self->lock);
+  pthread_cond_destroy(&self->wake);
+}
+
+void Prefetcher_hint(Prefetcher* self, size_t offset, size_t size, int direction){
+  if(!self->running) return;
+  pthread_mutex_lock(&self->lock);
+  if(self->offset != offset || self->size != size || self->direction != direction){
+    self->offset = offset;
+    self->size = size;
+    self->direction = direction;
+    self->generation++;
+    pthread_cond_signal(&self->wake);
+  }
+  pthread_mutex_unlock(&self->lock);
+}
@@ -0,0 +1,37 @@
+#ifndef PREFETCH_H_
+#define PREFETCH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "data_source.h"
+
+// how many viewports worth of data are read ahead in the scroll direction
+#ifndef PREFETCH_SCREENS
+#define PREFETCH_SCREENS 4
+#endif // PREFETCH_SCREENS
+
+// background worker that pulls the data around the viewport into memory
+// before it is scrolled to, so the render thread rarely waits on the disk
+typedef struct{
+  DataSource* source;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  bool running;
+
+  // latest viewport reported by the render thread
+  size_t offset;
+  size_t size;
+  int direction;
+  size_t generation;
+} Prefetcher;
+
+bool Prefetcher_start(Prefetcher* self, DataSource* source);
+void Prefetcher_stop(Prefetcher* self);
+
+// report the visible byte range and the direction it last moved in
+void Prefetcher_hint(Prefetcher* self, size_t offset, size_t size, int direction);
+
+#endif // PREFETCH_H_
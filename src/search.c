@@ -0,0 +1,802 @@
+#include "nob.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <immintrin.h>
+#include <math.h>
+
+#include "byte_regex.h"
+#include "gather.h"
+#include "search.h"
+#include "signature.h"
+
+static int hex_digit(char c){
+  if(c >= '0' && c <= '9') return c - '0';
+  if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// exact bytes outrank nibbles outrank wildcards, and among exact bytes the
+// ones padding is made of are too common to make good anchors
+static int SearchPattern_rank(SearchPattern* self, size_t i){
+  int rank = __builtin_popcount(self->mask[i])*2;
+  if(self->mask[i] == 0xFF && self->bytes[i] != 0x00 && self->bytes[i] != 0xFF) rank++;
+  return rank;
+}
+
+bool SearchPattern_make(SearchPattern* self, const uint8_t* bytes, const uint8_t* mask, size_t length){
+  if(length == 0 || length > SEARCH_PATTERN_MAX) return false;
+  self->length = length;
+  self->masked = false;
+  for(size_t i = 0; i < length; ++i){
+    self->mask[i] = mask == NULL ? 0xFF : mask[i];
+    self->bytes[i] = bytes[i] & self->mask[i];
+    if(self->mask[i] != 0xFF) self->masked = true;
+  }
+
+  self->first = 0;
+  self->last = 0;
+  int best = -1;
+  for(size_t i = 0; i < length; ++i){
+    int rank = SearchPattern_rank(self, i);
+    if(rank > best){
+      best = rank;
+      self->first = i;
+    }
+    if(rank >= best) self->last = i;
+  }
+  return true;
+}
+
+static int hex_nibble(char c, uint8_t* mask){
+  *mask = 0xF;
+  if(c == '?'){
+    *mask = 0;
+    return 0;
+  }
+  return hex_digit(c);
+}
+
+bool SearchPattern_parse(SearchPattern* self, const char* text){
+  uint8_t bytes[SEARCH_PATTERN_MAX];
+  uint8_t mask[SEARCH_PATTERN_MAX];
+  size_t length = 0;
+  while(isspace((unsigned char)*text)) text++;
+
+  if(*text == '"'){
+    for(text++; *text != '\0' && *text != '"'; ++text){
+      if(length == SEARCH_PATTERN_MAX) return false;
+      bytes[length++] = *text;
+    }
+    // anything after the text makes it a regex
+    if(*text == '"') text++;
+    while(isspace((unsigned char)*text)) text++;
+    if(*text != '\0') return false;
+    return SearchPattern_make(self, bytes, NULL, length);
+  }
+
+  while(*text != '\0'){
+    if(isspace((unsigned char)*text)){
+      text++;
+      continue;
+    }
+    uint8_t high_mask, low_mask;
+    int high = hex_nibble(text[0], &high_mask);
+    int low = high < 0 ? -1 : hex_nibble(text[1], &low_mask);
+    if(low < 0 || length == SEARCH_PATTERN_MAX) return false;
+    bytes[length] = high*16 + low;
+    mask[length] = high_mask*16 + low_mask;
+    length++;
+    text += 2;
+  }
+  return SearchPattern_make(self, bytes, mask, length);
+}
+
+static inline bool search_verify_scalar(const uint8_t* at, SearchPattern* pattern, size_t i){
+  for(; i < pattern->length; ++i){
+    if((at[i] & pattern->mask[i]) != pattern->bytes[i]) return false;
+  }
+  return true;
+}
+
+// checks a candidate whose anchors are known to match
+static inline bool search_verify(const uint8_t* at, SearchPattern* pattern){
+  if(!pattern->masked) return memcmp(at, pattern->bytes, pattern->length) == 0;
+  return search_verify_scalar(at, pattern, 0);
+}
+
+static inline bool search_anchor(const uint8_t* at, SearchPattern* pattern, size_t i){
+  return (at[i] & pattern->mask[i]) == pattern->bytes[i];
+}
+
+void SearchHits_add(SearchHits* self, size_t offset, size_t length, size_t id){
+  if(self->count >= SEARCH_MAX_HITS) return;
+  SearchHit hit = {
+    .offset = offset,
+    .length = length,
+    .id = id,
+  };
+  nob_da_append(self, hit);
+}
+
+// candidates from memchr on the first anchor when it is an exact byte, also
+// finishes the vector kernels
+static void search_scalar(const uint8_t* haystack, size_t size, size_t limit, SearchPattern* pattern,
+    size_t base, SearchHits* hits, size_t i){
+  size_t length = pattern->length;
+  if(size < length) return;
+  if(limit > size - length + 1) limit = size - length + 1;
+  size_t first = pattern->first;
+  bool exact = pattern->mask[first] == 0xFF;
+  while(i < limit && hits->count < SEARCH_MAX_HITS){
+    if(exact){
+      const uint8_t* at = memchr(haystack + i + first, pattern->bytes[first], limit - i);
+      if(at == NULL) break;
+      i = at - haystack - first;
+    }else if(!search_anchor(haystack + i, pattern, first)){
+      i++;
+      continue;
+    }
+    if(search_anchor(haystack + i, pattern, pattern->last) && search_verify(haystack + i, pattern)){
+      SearchHits_add(hits, base + i, pattern->length, 0);
+    }
+    i++;
+  }
+}
+
+static void search_generic(const uint8_t* haystack, size_t size, size_t limit, SearchPattern* pattern,
+    size_t base, SearchHits* hits){
+  search_scalar(haystack, size, limit, pattern, base, hits, 0);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// compares 16 bytes at a time under the mask, the rest byte by byte
+__attribute__((target("sse2")))
+static bool search_verify_sse2(const uint8_t* at, SearchPattern* pattern){
+  if(!pattern->masked) return memcmp(at, pattern->bytes, pattern->length) == 0;
+  size_t i = 0;
+  for(; i + 16 <= pattern->length; i += 16){
+    __m128i x = _mm_loadu_si128((const __m128i*)(at + i));
+    __m128i mask = _mm_loadu_si128((const __m128i*)(pattern->mask + i));
+    __m128i bytes = _mm_loadu_si128((const __m128i*)(pattern->bytes + i));
+    if(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(x, mask), bytes)) != 0xFFFF) return false;
+  }
+  return search_verify_scalar(at, pattern, i);
+}
+
+__attribute__((target("sse2")))
+static void search_sse2(const uint8_t* haystack, size_t size, size_t limit, SearchPattern* pattern,
+    size_t base, SearchHits* hits){
+  size_t first = pattern->first;
+  size_t last = pattern->last;
+  const __m128i first_mask = _mm_set1_epi8(pattern->mask[first]);
+  const __m128i first_byte = _mm_set1_epi8(pattern->bytes[first]);
+  const __m128i last_mask = _mm_set1_epi8(pattern->mask[last]);
+  const __m128i last_byte = _mm_set1_epi8(pattern->bytes[last]);
+  size_t i = 0;
+  for(; i < limit && i + pattern->length-1 + 16 <= size && hits->count < SEARCH_MAX_HITS; i += 16){
+    __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)(haystack + i + first)), first_mask);
+    __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)(haystack + i + last)), last_mask);
+    uint32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first_byte), _mm_cmpeq_epi8(b, last_byte)));
+    while(mask != 0){
+      size_t at = i + __builtin_ctz(mask);
+      if(at >= limit) break;
+      if(search_verify_sse2(haystack + at, pattern)) SearchHits_add(hits, base + at, pattern->length, 0);
+      mask &= mask-1;
+    }
+  }
+  search_scalar(haystack, size, limit, pattern, base, hits, i);
+}
+
+__attribute__((target("avx2")))
+static bool search_verify_avx2(const uint8_t* at, SearchPattern* pattern){
+  if(!pattern->masked) return memcmp(at, pattern->bytes, pattern->length) == 0;
+  size_t i = 0;
+  for(; i + 32 <= pattern->length; i += 32){
+    __m256i x = _mm256_loadu_si256((const __m256i*)(at + i));
+    __m256i mask = _mm256_loadu_si256((const __m256i*)(pattern->mask + i));
+    __m256i bytes = _mm256_loadu_si256((const __m256i*)(pattern->bytes + i));
+    if(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(x, mask), bytes)) != -1) return false;
+  }
+  return search_verify_scalar(at, pattern, i);
+}
+
+__attribute__((target("avx2")))
+static void search_avx2(const uint8_t* haystack, size_t size, size_t limit, SearchPattern* pattern,
+    size_t base, SearchHits* hits){
+  size_t first = pattern->first;
+  size_t last = pattern->last;
+  const __m256i first_mask = _mm256_set1_epi8(pattern->mask[first]);
+  const __m256i first_byte = _mm256_set1_epi8(pattern->bytes[first]);
+  const __m256i last_mask = _mm256_set1_epi8(pattern->mask[last]);
+  const __m256i last_byte = _mm256_set1_epi8(pattern->bytes[last]);
+  size_t i = 0;
+  for(; i < limit && i + pattern->length-1 + 32 <= size && hits->count < SEARCH_MAX_HITS; i += 32){
+    __m256i a = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(haystack + i + first)), first_mask);
+    __m256i b = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(haystack + i + last)), last_mask);
+    uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first_byte), _mm256_cmpeq_epi8(b, last_byte)));
+    while(mask != 0){
+      size_t at = i + __builtin_ctz(mask);
+      if(at >= limit) break;
+      if(search_verify_avx2(haystack + at, pattern)) SearchHits_add(hits, base + at, pattern->length, 0);
+      mask &= mask-1;
+    }
+  }
+  search_scalar(haystack, size, limit, pattern, base, hits, i);
+}
+
+#endif
+
+typedef void (*SearchKernel)(const uint8_t* haystack, size_t size, size_t limit, SearchPattern* pattern,
+    size_t base, SearchHits* hits);
+
+static SearchKernel search_kernel = NULL;
+static const char* search_kernel_label = "scalar";
+
+static void search_resolve(void){
+  search_kernel = search_generic;
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2")){
+    search_kernel = search_avx2;
+    search_kernel_label = "avx2";
+  }else if(__builtin_cpu_supports("sse2")){
+    search_kernel = search_sse2;
+    search_kernel_label = "sse2";
+  }
+#endif
+}
+
+void search_bytes(const uint8_t* haystack, size_t size, size_t limit, SearchPattern* pattern,
+    size_t base, SearchHits* hits){
+  if(pattern->length == 0) return;
+  if(search_kernel == NULL) search_resolve();
+  search_kernel(haystack, size, limit, pattern, base, hits);
+}
+
+const char* search_kernel_name(void){
+  if(search_kernel == NULL) search_resolve();
+  return search_kernel_label;
+}
+
+static const char* skip_spaces(const char* text){
+  while(isspace((unsigned char)*text)) text++;
+  return text;
+}
+
+static bool ValueQuery_number(const char** text, double* value){
+  char* end;
+  *value = strtod(*text, &end);
+  if(end == *text) return false;
+  *text = end;
+  return true;
+}
+
+// the bits of an integer of kind, positive numbers are taken as the bits so
+// 0xFFFFFFFF is fine as an i32
+static bool ValueQuery_integer(const char** text, TypeKind kind, uint64_t* bits){
+  const char* at = skip_spaces(*text);
+  size_t width = type_kinds[kind].size*8;
+  uint64_t top = width == 64 ? UINT64_MAX : (1ull << width) - 1;
+  char* end;
+  errno = 0;
+  if(*at == '-'){
+    long long x = strtoll(at, &end, 0);
+    if(type_kinds[kind].class != TypeClass_SIGNED) return false;
+    if(width < 64 && x < -(1ll << (width-1))) return false;
+    *bits = (uint64_t)x & top;
+  }else{
+    unsigned long long x = strtoull(at, &end, 0);
+    if(x > top) return false;
+    *bits = x;
+  }
+  if(end == at || errno == ERANGE) return false;
+  *text = end;
+  return true;
+}
+
+// nearest value of kind to x, only floats narrower than a double round
+static double ValueQuery_round(TypeKind kind, double x){
+  if(type_kinds[kind].class != TypeClass_FLOAT) return x;
+  if(type_kinds[kind].size == 4) return (float)x;
+  if(type_kinds[kind].size != 2 || x == 0 || !isfinite(x)) return x;
+  // 11 significant bits, and a fixed step of 2^-24 below the normals
+  int exponent;
+  frexp(x, &exponent);
+  if(exponent < -13) exponent = -13;
+  double step = ldexp(1, exponent - 11);
+  double rounded = nearbyint(x/step)*step;
+  return fabs(rounded) > 65504 ? copysign(INFINITY, x) : rounded;
+}
+
+bool ValueQuery_parse(ValueQuery* self, const char* text){
+  memset(self, 0, sizeof(*self));
+  text = skip_spaces(text);
+  size_t n = 0;
+  while(isalnum((unsigned char)text[n])) n++;
+  self->kind = Type_KIND_COUNT;
+  for(TypeKind kind = Type_I8; kind <= Type_F64_BE; ++kind){
+    const char* name = type_kinds[kind].name;
+    if(strlen(name) == n && memcmp(name, text, n) == 0) self->kind = kind;
+  }
+  if(self->kind == Type_KIND_COUNT) return false;
+  text = skip_spaces(text + n);
+
+  bool is_float = type_kinds[self->kind].class == TypeClass_FLOAT;
+  uint64_t value = 0;
+  uint64_t mask = UINT64_MAX;
+  if(strncmp(text, "==", 2) == 0){
+    text += 2;
+    if(is_float){
+      if(!ValueQuery_number(&text, &self->low)) return false;
+      self->high = self->low;
+      self->range = true;
+    }else if(!ValueQuery_integer(&text, self->kind, &value)){
+      return false;
+    }
+  }else if(strncmp(text, "in", 2) == 0){
+    text = skip_spaces(text + 2);
+    if(*text == '[') text++;
+    if(!ValueQuery_number(&text, &self->low)) return false;
+    text = skip_spaces(text);
+    if(*text == ',') text++;
+    if(!ValueQuery_number(&text, &self->high)) return false;
+    text = skip_spaces(text);
+    if(*text == ']') text++;
+    self->range = true;
+  }else if(*text == '&' && !is_float){
+    text++;
+    if(!ValueQuery_integer(&text, self->kind, &mask)) return false;
+    text = skip_spaces(text);
+    if(strncmp(text, "==", 2) != 0) return false;
+    text += 2;
+    if(!ValueQuery_integer(&text, self->kind, &value)) return false;
+  }else{
+    return false;
+  }
+
+  text = skip_spaces(text);
+  if(strncmp(text, "aligned", 7) == 0){
+    self->aligned = true;
+    text = skip_spaces(text + 7);
+  }
+  if(*text != '\0') return false;
+  if(self->range){
+    // decoded floats only take the values of their kind, so 0.1 has to be
+    // compared as the f32 0.1 rounds to
+    self->low = ValueQuery_round(self->kind, self->low);
+    self->high = ValueQuery_round(self->kind, self->high);
+    // also false for nan
+    return self->low <= self->high;
+  }
+
+  uint8_t bytes[8];
+  uint8_t masks[8];
+  size_t size = type_kinds[self->kind].size;
+  for(size_t i = 0; i < size; ++i){
+    size_t at = type_kinds[self->kind].big_endian ? size-1-i : i;
+    bytes[at] = value >> (8*i);
+    masks[at] = mask >> (8*i);
+  }
+  return SearchPattern_make(&self->pattern, bytes, masks, size);
+}
+
+// first hit at or after offset, the lock must be held
+static size_t SearchJob_lower_bound(SearchJob* self, size_t offset){
+  size_t low = 0;
+  size_t high = self->hits.count;
+  while(low < high){
+    size_t mid = low + (high-low)/2;
+    if(self->hits.items[mid].offset < offset) low = mid+1;
+    else high = mid;
+  }
+  return low;
+}
+
+// keeps the lowest SEARCH_MAX_HITS offsets, a later chunk may have finished
+// first. The lock must be held
+static void SearchJob_trim(SearchJob* self){
+  if(self->hits.count < SEARCH_MAX_HITS) return;
+  size_t last = self->hits.items[SEARCH_MAX_HITS-1].offset;
+  if(self->chunks != NULL){
+    // until stitching is done there may be fewer hits in the end, the
+    // chunks the dropped ones came from are scanned on from last then
+    size_t first = last/SEARCH_CHUNK_SIZE;
+    size_t final = self->hits.items[self->hits.count-1].offset/SEARCH_CHUNK_SIZE;
+    for(size_t i = first; i <= final; ++i){
+      size_t cut = i == first ? last+1 : i*SEARCH_CHUNK_SIZE;
+      if(self->chunks[i].merged && self->chunks[i].valid > cut) self->chunks[i].valid = cut;
+    }
+  }
+  self->hits.count = SEARCH_MAX_HITS;
+  self->truncated = true;
+  atomic_store(&self->horizon, last);
+}
+
+// a chunk starts matching where it begins, while a scan from the start goes
+// on from the end of the match the chunk before ran into. Rescans from there
+// until a match starts at one of the chunk's own hits, from which on they
+// agree, and on past where its hits were dropped. The lock must be held and
+// is let go of for the reading and scanning
+static void SearchJob_stitch(SearchJob* self, size_t chunk){
+  size_t boundary = chunk*SEARCH_CHUNK_SIZE;
+  size_t end = boundary + SEARCH_CHUNK_SIZE;
+  if(end > self->source->count) end = self->source->count;
+  size_t kept = SearchJob_lower_bound(self, boundary);
+  size_t begin = boundary;
+  if(kept > 0){
+    SearchHit last = self->hits.items[kept-1];
+    if(last.offset + last.length > begin) begin = last.offset + last.length;
+  }
+  size_t valid = self->chunks[chunk].valid;
+  if(begin == boundary && valid == end) return;
+
+  // the chunk's own hits, the ones before the boundary are done already
+  // and later chunks only add hits past end
+  size_t count = SearchJob_lower_bound(self, valid) - kept;
+  SearchHit* own = NULL;
+  if(count > 0){
+    own = malloc(count*sizeof(SearchHit));
+    NOB_ASSERT(own != NULL && "Buy more RAM lol");
+    memcpy(own, self->hits.items + kept, count*sizeof(SearchHit));
+  }
+  pthread_mutex_unlock(&self->lock);
+
+  // the hits of the whole chunk
+  SearchHits found = {0};
+  if(begin < end){
+    size_t span = end + self->overlap - begin;
+    uint8_t* buffer = self->source->kind != DataSource_MMAP ? malloc(span) : NULL;
+    size_t got = 0;
+    const uint8_t* bytes = NULL;
+    if(self->source->kind == DataSource_MMAP || buffer != NULL){
+      bytes = DataSource_scan(self->source, begin, span, buffer, &got);
+    }
+    size_t i = 0;
+    size_t at = begin;
+    size_t start, stop;
+    while(bytes != NULL && ByteRegex_find(self->regex, bytes, got, at - begin, &start, &stop)){
+      start += begin;
+      stop += begin;
+      if(start >= end) break;
+      while(i < count && own[i].offset < start) i++;
+      if(i < count && own[i].offset == start){
+        // in step, the rest of the chunk's hits are right
+        for(; i < count; ++i) SearchHits_add(&found, own[i].offset, own[i].length, 0);
+        if(valid == end) break;
+        at = own[count-1].offset + own[count-1].length;
+        continue;
+      }
+      SearchHits_add(&found, start, stop - start, 0);
+      at = stop;
+    }
+    if(bytes == NULL){
+      // without the bytes the chunk's hits are left as they are
+      found.count = 0;
+      for(size_t i = 0; i < count; ++i) SearchHits_add(&found, own[i].offset, own[i].length, 0);
+      end = valid;
+    }
+    free(buffer);
+  }
+  free(own);
+
+  pthread_mutex_lock(&self->lock);
+  // trimming may have dropped some of the chunk's hits meanwhile, so they
+  // are found by offset again
+  size_t from = SearchJob_lower_bound(self, boundary);
+  size_t to = SearchJob_lower_bound(self, end);
+  size_t total = self->hits.count - (to - from) + found.count;
+  nob_da_reserve(&self->hits, total);
+  SearchHit* items = self->hits.items;
+  memmove(items + from + found.count, items + to, (self->hits.count - to)*sizeof(SearchHit));
+  if(found.count > 0) memcpy(items + from, found.items, found.count*sizeof(SearchHit));
+  self->hits.count = total;
+  self->chunks[chunk].valid = found.count == SEARCH_MAX_HITS ? found.items[found.count-1].offset+1 : end;
+  nob_da_free(found);
+  SearchJob_trim(self);
+}
+
+// valid is how far the chunk's hits are complete
+static void SearchJob_merge(SearchJob* self, size_t chunk, SearchHits* local, size_t valid){
+  pthread_mutex_lock(&self->lock);
+  size_t n = local->count;
+  if(n > 0){
+    // chunks finish roughly in order, so this is an append most of the time
+    size_t at = SearchJob_lower_bound(self, local->items[0].offset);
+    nob_da_reserve(&self->hits, self->hits.count + n);
+    memmove(self->hits.items + at + n, self->hits.items + at, (self->hits.count - at)*sizeof(SearchHit));
+    memcpy(self->hits.items + at, local->items, n*sizeof(SearchHit));
+    self->hits.count += n;
+  }
+  if(self->chunks != NULL){
+    self->chunks[chunk].merged = true;
+    self->chunks[chunk].valid = valid;
+  }
+  SearchJob_trim(self);
+  if(self->chunks != NULL && !self->stitching){
+    // chunks are stitched in order once they are merged, by one worker at a
+    // time, the others leave it their chunks
+    self->stitching = true;
+    for(; self->stitched < self->job.chunks && self->chunks[self->stitched].merged; self->stitched++){
+      // the hits before this chunk are right and there are enough of them
+      if(SearchJob_lower_bound(self, self->stitched*SEARCH_CHUNK_SIZE) == SEARCH_MAX_HITS) break;
+      SearchJob_stitch(self, self->stitched);
+      // stitching may have made room, chunks left out are scanned after all
+      if(self->hits.count < SEARCH_MAX_HITS) atomic_store(&self->horizon, SIZE_MAX);
+    }
+    // every chunk is in and there was room for all of them
+    if(self->stitched == self->job.chunks && self->hits.count < SEARCH_MAX_HITS) self->truncated = false;
+    self->stitching = false;
+  }
+  pthread_mutex_unlock(&self->lock);
+}
+
+static int SearchHit_compare(const void* a, const void* b){
+  const SearchHit* x = a;
+  const SearchHit* y = b;
+  if(x->offset != y->offset) return x->offset < y->offset ? -1 : 1;
+  return x->id < y->id ? -1 : x->id > y->id;
+}
+
+#define SEARCH_VALUE_BLOCK 1024
+
+void search_values(const uint8_t* haystack, size_t size, size_t limit, ValueQuery* query,
+    size_t base, SearchHits* hits){
+  const TypeKindInfo* info = &type_kinds[query->kind];
+  const TypeKindInfo* native = &type_kinds[TypeKind_native(query->kind)];
+  size_t width = info->size;
+  if(size < width) return;
+  // values starting before limit have to be whole
+  if(limit > size - width + 1) limit = size - width + 1;
+
+  uint64_t column[SEARCH_VALUE_BLOCK];
+  double values[SEARCH_VALUE_BLOCK];
+  size_t first = hits->count;
+  for(size_t shift = 0; shift < width && shift < limit; ++shift){
+    if(query->aligned && (base + shift) % width != 0) continue;
+    size_t count = (limit - shift + width-1)/width;
+    for(size_t i = 0; i < count && hits->count < SEARCH_MAX_HITS; i += SEARCH_VALUE_BLOCK){
+      size_t n = count - i;
+      if(n > SEARCH_VALUE_BLOCK) n = SEARCH_VALUE_BLOCK;
+      const uint8_t* src = haystack + shift + i*width;
+      if(info->swap){
+        gather(column, src, width, n, width, true);
+        src = (const uint8_t*)column;
+      }
+      native->to_doubles(src, n, values);
+      for(size_t j = 0; j < n; ++j){
+        if(values[j] >= query->low && values[j] <= query->high){
+          SearchHits_add(hits, base + shift + (i+j)*width, width, 0);
+        }
+      }
+    }
+  }
+  // every shift comes out in order on its own
+  if(hits->count - first > 1 && width > 1){
+    qsort(hits->items + first, hits->count - first, sizeof(SearchHit), SearchHit_compare);
+  }
+}
+
+// the bytes of a value of width bytes at value, as a little endian word
+static inline uint64_t search_load(const uint8_t* value, size_t width){
+  uint8_t word[8] = {0};
+  switch(width){
+    case 8: memcpy(word, value, 8); break;
+    case 4: memcpy(word, value, 4); break;
+    case 2: memcpy(word, value, 2); break;
+    default: word[0] = value[0]; break;
+  }
+  uint64_t x;
+  memcpy(&x, word, sizeof(x));
+  return x;
+}
+
+// a pattern of width bytes compared at only the offsets that are a
+// multiple of width, the candidates are few enough to check every one
+static void search_aligned(const uint8_t* haystack, size_t size, size_t limit, SearchPattern* pattern,
+    size_t width, size_t base, SearchHits* hits){
+  if(size < width) return;
+  if(limit > size - width + 1) limit = size - width + 1;
+  uint64_t bytes = search_load(pattern->bytes, width);
+  uint64_t mask = search_load(pattern->mask, width);
+  for(size_t i = (width - base%width)%width; i < limit && hits->count < SEARCH_MAX_HITS; i += width){
+    if((search_load(haystack + i, width) & mask) == bytes) SearchHits_add(hits, base + i, width, 0);
+  }
+}
+
+static void SearchJob_values(SearchJob* self, const uint8_t* bytes, size_t got, size_t limit,
+    size_t begin, SearchHits* local){
+  ValueQuery* query = &self->query;
+  size_t width = type_kinds[query->kind].size;
+  if(query->range) search_values(bytes, got, limit, query, begin, local);
+  else if(query->aligned) search_aligned(bytes, got, limit, &query->pattern, width, begin, local);
+  else search_bytes(bytes, got, limit, &query->pattern, begin, local);
+}
+
+static void SearchJob_run(Job* job, size_t chunk){
+  SearchJob* self = (SearchJob*)job;
+  if(Job_is_cancelled(job)) return;
+  size_t begin = chunk*SEARCH_CHUNK_SIZE;
+  size_t limit = self->source->count - begin;
+  if(limit > SEARCH_CHUNK_SIZE) limit = SEARCH_CHUNK_SIZE;
+  SearchHits local = {0};
+  if(begin > atomic_load(&self->horizon)){
+    // would only find hits that are dropped, regex chunks are still merged
+    // so stitching can scan them when it makes room
+    if(self->chunks != NULL) SearchJob_merge(self, chunk, &local, begin);
+    return;
+  }
+  // read on into the next chunk so matches starting in this one are whole
+  size_t span = limit + self->overlap;
+
+  uint8_t* buffer = self->source->kind != DataSource_MMAP ? malloc(span) : NULL;
+  size_t got = 0;
+  const uint8_t* bytes = NULL;
+  if(self->source->kind == DataSource_MMAP || buffer != NULL){
+    bytes = DataSource_scan(self->source, begin, span, buffer, &got);
+  }
+
+  if(bytes != NULL){
+    switch(self->kind){
+      case SearchKind_BYTES:
+        search_bytes(bytes, got, limit, &self->pattern, begin, &local);
+        break;
+      case SearchKind_SIGNATURES:
+        SignatureSet_scan(self->signatures, bytes, got, limit, begin, &local);
+        // found where they end, so longer ones come out of order
+        if(local.count > 1) qsort(local.items, local.count, sizeof(SearchHit), SearchHit_compare);
+        break;
+      case SearchKind_VALUES:
+        SearchJob_values(self, bytes, got, limit, begin, &local);
+        break;
+      case SearchKind_REGEX:
+        ByteRegex_scan(self->regex, bytes, got, limit, begin, &local);
+        break;
+    }
+  }
+  free(buffer);
+  // a full list may have stopped early
+  size_t valid = local.count == SEARCH_MAX_HITS ? local.items[local.count-1].offset+1 : begin + limit;
+  if(bytes == NULL) valid = begin;
+  SearchJob_merge(self, chunk, &local, valid);
+  nob_da_free(local);
+}
+
+void SearchJob_init(SearchJob* self){
+  memset(self, 0, sizeof(*self));
+  pthread_mutex_init(&self->lock, NULL);
+}
+
+void SearchJob_destroy(SearchJob* self, ThreadPool* pool){
+  SearchJob_cancel(self, pool);
+  nob_da_free(self->hits);
+  free(self->chunks);
+  pthread_mutex_destroy(&self->lock);
+  memset(self, 0, sizeof(*self));
+}
+
+static void SearchJob_submit(SearchJob* self, ThreadPool* pool, DataSource* source){
+  self->source = source;
+  self->running = true;
+  self->job.run = SearchJob_run;
+  self->job.chunks = (source->count + SEARCH_CHUNK_SIZE-1)/SEARCH_CHUNK_SIZE;
+  atomic_store(&self->horizon, SIZE_MAX);
+  free(self->chunks);
+  self->chunks = NULL;
+  if(self->kind == SearchKind_REGEX){
+    self->chunks = calloc(self->job.chunks, sizeof(SearchChunk));
+    NOB_ASSERT(self->chunks != NULL && "Buy more RAM lol");
+    self->stitched = 0;
+    self->stitching = false;
+  }
+  ThreadPool_submit(pool, &self->job);
+}
+
+void SearchJob_start(SearchJob* self, ThreadPool* pool, DataSource* source, SearchPattern* pattern){
+  SearchJob_cancel(self, pool);
+  if(pattern->length == 0 || source->count < pattern->length || !pool->running) return;
+  // resolved here so the workers never race on it
+  search_kernel_name();
+
+  self->kind = SearchKind_BYTES;
+  self->pattern = *pattern;
+  self->overlap = pattern->length-1;
+  SearchJob_submit(self, pool, source);
+}
+
+void SearchJob_start_signatures(SearchJob* self, ThreadPool* pool, DataSource* source, SignatureSet* signatures){
+  SearchJob_cancel(self, pool);
+  if(signatures->states == 0 || signatures->longest == 0 || source->count == 0 || !pool->running) return;
+  signature_kernel_name();
+
+  self->kind = SearchKind_SIGNATURES;
+  self->signatures = signatures;
+  self->overlap = signatures->longest-1;
+  SearchJob_submit(self, pool, source);
+}
+
+void SearchJob_start_values(SearchJob* self, ThreadPool* pool, DataSource* source, ValueQuery* query){
+  SearchJob_cancel(self, pool);
+  size_t width = type_kinds[query->kind].size;
+  if(source->count < width || !pool->running) return;
+  if(query->range) gather_kernel_name();
+  else search_kernel_name();
+
+  self->kind = SearchKind_VALUES;
+  self->query = *query;
+  self->overlap = width-1;
+  SearchJob_submit(self, pool, source);
+}
+
+void SearchJob_start_regex(SearchJob* self, ThreadPool* pool, DataSource* source, ByteRegex* regex){
+  SearchJob_cancel(self, pool);
+  if(regex->longest == 0 || source->count == 0 || !pool->running) return;
+
+  self->kind = SearchKind_REGEX;
+  self->regex = regex;
+  self->overlap = regex->longest-1;
+  SearchJob_submit(self, pool, source);
+}
+
+void SearchJob_cancel(SearchJob* self, ThreadPool* pool){
+  Job_cancel(pool, &self->job);
+  self->running = false;
+  pthread_mutex_lock(&self->lock);
+  self->hits.count = 0;
+  self->truncated = false;
+  pthread_mutex_unlock(&self->lock);
+}
+
+void SearchJob_update(SearchJob* self){
+  if(self->running && Job_is_done(&self->job)) self->running = false;
+}
+
+size_t SearchJob_count(SearchJob* self){
+  pthread_mutex_lock(&self->lock);
+  size_t count = self->hits.count;
+  pthread_mutex_unlock(&self->lock);
+  return count;
+}
+
+bool SearchJob_is_truncated(SearchJob* self){
+  pthread_mutex_lock(&self->lock);
+  bool truncated = self->truncated;
+  pthread_mutex_unlock(&self->lock);
+  return truncated;
+}
+
+SearchHit SearchJob_hit(SearchJob* self, size_t i){
+  pthread_mutex_lock(&self->lock);
+  NOB_ASSERT(i < self->hits.count);
+  SearchHit hit = self->hits.items[i];
+  pthread_mutex_unlock(&self->lock);
+  return hit;
+}
+
+size_t SearchJob_find(SearchJob* self, size_t offset){
+  pthread_mutex_lock(&self->lock);
+  size_t i = SearchJob_lower_bound(self, offset);
+  pthread_mutex_unlock(&self->lock);
+  return i;
+}
+
+size_t SearchJob_count_range(SearchJob* self, size_t begin, size_t end){
+  if(end <= begin) return 0;
+  pthread_mutex_lock(&self->lock);
+  size_t count = SearchJob_lower_bound(self, end) - SearchJob_lower_bound(self, begin);
+  pthread_mutex_unlock(&self->lock);
+  return count;
+}
+
+size_t SearchJob_range(SearchJob* self, size_t begin, size_t end, SearchHit* dst, size_t capacity){
+  pthread_mutex_lock(&self->lock);
+  size_t n = 0;
+  for(size_t i = SearchJob_lower_bound(self, begin); i < self->hits.count && n < capacity; ++i){
+    if(self->hits.items[i].offset >= end) break;
+    dst[n++] = self->hits.items[i];
+  }
+  pthread_mutex_unlock(&self->lock);
+  return n;
+}
@@ -0,0 +1,159 @@
+#ifndef SEARCH_H_
+#define SEARCH_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "data_source.h"
+#include "thread_pool.h"
+#include "type.h"
+
+#define SEARCH_PATTERN_MAX 256
+
+// bytes every chunk of a SearchJob starts matches in, matches that straddle
+// two chunks are found by the first one reading on into the next
+#ifndef SEARCH_CHUNK_SIZE
+#define SEARCH_CHUNK_SIZE (4*1024*1024)
+#endif // SEARCH_CHUNK_SIZE
+
+// hits kept at most, a pattern like 00 would find most of a file otherwise
+#ifndef SEARCH_MAX_HITS
+#define SEARCH_MAX_HITS (1024*1024)
+#endif // SEARCH_MAX_HITS
+
+// a byte matches when (byte & mask) == bytes, so a mask of 0 is a wildcard
+// and 0xF0 or 0x0F leave one nibble open
+typedef struct{
+  uint8_t bytes[SEARCH_PATTERN_MAX];
+  uint8_t mask[SEARCH_PATTERN_MAX];
+  size_t length;
+  bool masked; // some mask is not 0xFF
+  // the two most specific bytes, candidates are found by comparing these
+  // and then verified, so wildcards at the start cost nothing
+  size_t first;
+  size_t last;
+} SearchPattern;
+
+// mask may be NULL for an exact pattern, returns false when length is 0 or
+// larger than SEARCH_PATTERN_MAX
+bool SearchPattern_make(SearchPattern* self, const uint8_t* bytes, const uint8_t* mask, size_t length);
+// parses hex bytes like "4D 5a ?? ?? 5? 45", where ? leaves a nibble open,
+// or a quoted "text" with nothing after it, returns false when text is
+// neither or empty
+bool SearchPattern_parse(SearchPattern* self, const char* text);
+
+typedef struct{
+  size_t offset;
+  uint32_t length;
+  uint32_t id; // which of the patterns matched, 0 for a single pattern
+} SearchHit;
+
+typedef struct{
+  SearchHit* items;
+  size_t count;
+  size_t capacity;
+} SearchHits;
+
+// appends a hit unless there are SEARCH_MAX_HITS already
+void SearchHits_add(SearchHits* self, size_t offset, size_t length, size_t id);
+
+// appends base+i for every i < limit where pattern starts in haystack, in
+// order. Matches may run past limit but not past size, no more hits are
+// added once there are SEARCH_MAX_HITS. Candidates are found by comparing
+// the two anchor bytes of the pattern a vector at a time and verified with a
+// masked compare, dispatches at runtime to the widest kernel the cpu supports
+void search_bytes(const uint8_t* haystack, size_t size, size_t limit, SearchPattern* pattern,
+    size_t base, SearchHits* hits);
+
+// name of the kernel search_bytes dispatches to, for logging
+const char* search_kernel_name(void);
+
+// a typed value like "i32 == -5", "f32 in [0.5, 2]" or "u64 & 0xFF00 == 0x1200",
+// followed by "aligned" to only look at offsets that are a multiple of the
+// size. Integer == and & queries turn into a masked byte pattern in the byte
+// order of the kind, the rest decode values and compare them with a range
+typedef struct{
+  TypeKind kind;
+  bool aligned;
+  bool range;
+  double low, high;      // when range
+  SearchPattern pattern; // when not range
+} ValueQuery;
+
+bool ValueQuery_parse(ValueQuery* self, const char* text);
+
+// appends base+i for every i < limit where a value of query->kind decodes to
+// something in [low, high], in order for every shift within a value. Values
+// are gathered into host byte order and converted a block at a time
+void search_values(const uint8_t* haystack, size_t size, size_t limit, ValueQuery* query,
+    size_t base, SearchHits* hits);
+
+typedef struct SignatureSet SignatureSet;
+typedef struct ByteRegex ByteRegex;
+
+typedef enum{
+  SearchKind_BYTES,
+  SearchKind_SIGNATURES,
+  SearchKind_VALUES,
+  SearchKind_REGEX,
+} SearchKind;
+
+typedef struct{
+  bool merged;
+  size_t valid; // the chunk's hits are the ones its scan found up to here
+} SearchChunk;
+
+// searches the whole source on a pool, chunks merge their hits into the
+// sorted result as soon as they finish. Regex matches never overlap and
+// each one decides where the next can start, so once the chunks before one
+// are stitched the bytes after a match that runs into it are scanned again
+// until they agree with what the chunk found. The hits are then the ones a
+// scan from the start would find
+typedef struct{
+  Job job;
+  DataSource* source;
+  SearchKind kind;
+  SearchPattern pattern;
+  SignatureSet* signatures; // must outlive the search
+  ValueQuery query;
+  ByteRegex* regex; // must outlive the search
+  size_t overlap; // bytes a chunk reads past its end, longest match - 1
+  bool running;
+
+  pthread_mutex_t lock; // guards hits, truncated and the stitching
+  SearchHits hits;
+  bool truncated; // stopped at SEARCH_MAX_HITS
+  atomic_size_t horizon; // last hit kept once truncated, chunks past it are skipped
+  SearchChunk* chunks; // when searching for a regex
+  size_t stitched;     // leading chunks that are stitched
+  bool stitching;      // a worker is moving stitched on, without the lock while it reads
+} SearchJob;
+
+void SearchJob_init(SearchJob* self);
+void SearchJob_destroy(SearchJob* self, ThreadPool* pool);
+
+void SearchJob_start(SearchJob* self, ThreadPool* pool, DataSource* source, SearchPattern* pattern);
+// every signature of the set in a single pass
+void SearchJob_start_signatures(SearchJob* self, ThreadPool* pool, DataSource* source, SignatureSet* signatures);
+void SearchJob_start_values(SearchJob* self, ThreadPool* pool, DataSource* source, ValueQuery* query);
+void SearchJob_start_regex(SearchJob* self, ThreadPool* pool, DataSource* source, ByteRegex* regex);
+// stops the search and forgets the hits
+void SearchJob_cancel(SearchJob* self, ThreadPool* pool);
+// notices the search is done, call once a frame
+void SearchJob_update(SearchJob* self);
+
+size_t SearchJob_count(SearchJob* self);
+bool SearchJob_is_truncated(SearchJob* self);
+// hit i, which must be below the count
+SearchHit SearchJob_hit(SearchJob* self, size_t i);
+// index of the first hit at or after offset, the count when there is none
+size_t SearchJob_find(SearchJob* self, size_t offset);
+// number of hits starting in [begin, end)
+size_t SearchJob_count_range(SearchJob* self, size_t begin, size_t end);
+// copies up to capacity hits starting in [begin, end) into dst, returns how many
+size_t SearchJob_range(SearchJob* self, size_t begin, size_t end, SearchHit* dst, size_t capacity);
+
+#endif // SEARCH_H_
@@ -0,0 +1,290 @@
+#include "nob.h"
+
+#include <immintrin.h>
+
+#include "signature.h"
+
+void SignatureSet_add(SignatureSet* self, const char* name, const uint8_t* bytes, size_t length){
+  if(length == 0) return;
+  Signature signature = {
+    .name = strdup(name),
+    .bytes = malloc(length),
+    .length = length,
+    .same = SIGNATURE_NONE,
+  };
+  NOB_ASSERT(signature.name != NULL && signature.bytes != NULL && "Buy more RAM lol");
+  memcpy(signature.bytes, bytes, length);
+  nob_da_append(self, signature);
+}
+
+static void SignatureSet_free_automaton(SignatureSet* self){
+  free(self->next);
+  free(self->output);
+  free(self->dict);
+  free(self->depth);
+  self->next = NULL;
+  self->output = NULL;
+  self->dict = NULL;
+  self->depth = NULL;
+  self->states = 0;
+}
+
+void SignatureSet_build(SignatureSet* self){
+  SignatureSet_free_automaton(self);
+  size_t capacity = 1;
+  for(size_t i = 0; i < self->count; ++i) capacity += self->items[i].length;
+  self->next = calloc(capacity*256, sizeof(uint32_t));
+  self->output = malloc(capacity*sizeof(uint32_t));
+  self->dict = malloc(capacity*sizeof(uint32_t));
+  self->depth = calloc(capacity, sizeof(uint32_t));
+  uint32_t* fail = calloc(capacity, sizeof(uint32_t));
+  uint32_t* queue = malloc(capacity*sizeof(uint32_t));
+  NOB_ASSERT(self->next != NULL && self->output != NULL && self->dict != NULL && self->depth != NULL
+      && fail != NULL && queue != NULL && "Buy more RAM lol");
+  memset(self->output, 0xFF, capacity*sizeof(uint32_t));
+  memset(self->dict, 0xFF, capacity*sizeof(uint32_t));
+  memset(self->first, 0, sizeof(self->first));
+  memset(self->low, 0, sizeof(self->low));
+  memset(self->high, 0, sizeof(self->high));
+  self->states = 1;
+  self->longest = 0;
+
+  // trie of the signatures, state 0 is the root
+  for(size_t i = 0; i < self->count; ++i){
+    Signature* signature = &self->items[i];
+    uint32_t state = 0;
+    for(size_t j = 0; j < signature->length; ++j){
+      uint32_t* next = &self->next[state*256 + signature->bytes[j]];
+      if(*next == 0){
+        *next = self->states++;
+        self->depth[*next] = self->depth[state] + 1;
+      }
+      state = *next;
+    }
+    signature->same = self->output[state];
+    self->output[state] = i;
+    if(signature->length > self->longest) self->longest = signature->length;
+
+    uint8_t first = signature->bytes[0];
+    self->first[first] = true;
+    self->low[first & 0xF] |= 1 << ((first >> 4) & 7);
+    self->high[first >> 4] |= 1 << ((first >> 4) & 7);
+  }
+
+  // failure links breadth first, a state's row still only holds trie edges
+  // when it is visited, the missing ones are filled from its failure state
+  size_t head = 0;
+  size_t tail = 0;
+  for(size_t b = 0; b < 256; ++b){
+    if(self->next[b] != 0) queue[tail++] = self->next[b];
+  }
+  while(head < tail){
+    uint32_t state = queue[head++];
+    for(size_t b = 0; b < 256; ++b){
+      uint32_t* next = &self->next[state*256 + b];
+      uint32_t fallback = self->next[fail[state]*256 + b];
+      if(*next == 0){
+        *next = fallback;
+        continue;
+      }
+      fail[*next] = fallback;
+      self->dict[*next] = self->output[fallback] != SIGNATURE_NONE ? fallback : self->dict[fallback];
+      queue[tail++] = *next;
+    }
+  }
+  free(fail);
+  free(queue);
+
+  // transitions into states some signature ends in are flagged, so the scan
+  // only looks at the outputs when there are any
+  for(size_t i = 0; i < self->states*256; ++i){
+    uint32_t state = self->next[i];
+    if(self->output[state] != SIGNATURE_NONE || self->dict[state] != SIGNATURE_NONE){
+      self->next[i] |= SIGNATURE_MATCH;
+    }
+  }
+}
+
+bool SignatureSet_load(SignatureSet* self, const char* path){
+  Nob_String_Builder sb = {0};
+  if(!nob_read_entire_file(path, &sb)) return false;
+
+  bool result = true;
+  Nob_String_View content = nob_sb_to_sv(sb);
+  for(size_t line = 1; content.count > 0; ++line){
+    Nob_String_View text = nob_sv_trim(nob_sv_chop_by_delim(&content, '\n'));
+    if(text.count == 0 || text.data[0] == '#') continue;
+
+    Nob_String_View name = nob_sv_trim(nob_sv_chop_by_delim(&text, ':'));
+    SearchPattern pattern;
+    if(!SearchPattern_parse(&pattern, nob_temp_sv_to_cstr(text)) || pattern.masked){
+      nob_log(NOB_ERROR, "SignatureSet_load: %s:%zu: expected name: hex bytes", path, line);
+      nob_return_defer(false);
+    }
+    SignatureSet_add(self, nob_temp_sv_to_cstr(name), pattern.bytes, pattern.length);
+  }
+  SignatureSet_build(self);
+  nob_log(NOB_INFO, "SignatureSet_load: %zu signatures, %zu states", self->count, self->states);
+
+defer:
+  // half a set would be offered for scanning without an automaton
+  if(!result) SignatureSet_free(self);
+  nob_sb_free(sb);
+  return result;
+}
+
+void SignatureSet_free(SignatureSet* self){
+  for(size_t i = 0; i < self->count; ++i){
+    free(self->items[i].name);
+    free(self->items[i].bytes);
+  }
+  nob_da_free(*self);
+  SignatureSet_free_automaton(self);
+  memset(self, 0, sizeof(*self));
+}
+
+// first i below end where a signature may start, end when there is none
+static size_t signature_skip_scalar(SignatureSet* self, const uint8_t* haystack, size_t end, size_t i){
+  while(i < end && !self->first[haystack[i]]) i++;
+  return i;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// the low nibble of a byte selects the buckets it may be in and the high
+// nibble the one it has to be in, candidates are then checked against the table
+__attribute__((target("ssse3")))
+static size_t signature_skip_ssse3(SignatureSet* self, const uint8_t* haystack, size_t end, size_t i){
+  const __m128i low = _mm_loadu_si128((const __m128i*)self->low);
+  const __m128i high = _mm_loadu_si128((const __m128i*)self->high);
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  for(; i + 16 <= end; i += 16){
+    __m128i x = _mm_loadu_si128((const __m128i*)(haystack + i));
+    __m128i l = _mm_shuffle_epi8(low, _mm_and_si128(x, nibble));
+    __m128i h = _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi16(x, 4), nibble));
+    uint32_t mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(l, h), _mm_setzero_si128())) & 0xFFFF;
+    while(mask != 0){
+      size_t at = i + __builtin_ctz(mask);
+      if(self->first[haystack[at]]) return at;
+      mask &= mask-1;
+    }
+  }
+  return signature_skip_scalar(self, haystack, end, i);
+}
+
+__attribute__((target("avx2")))
+static size_t signature_skip_avx2(SignatureSet* self, const uint8_t* haystack, size_t end, size_t i){
+  const __m256i low = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)self->low));
+  const __m256i high = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)self->high));
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  for(; i + 32 <= end; i += 32){
+    __m256i x = _mm256_loadu_si256((const __m256i*)(haystack + i));
+    __m256i l = _mm256_shuffle_epi8(low, _mm256_and_si256(x, nibble));
+    __m256i h = _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble));
+    uint32_t mask = ~_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(l, h), _mm256_setzero_si256()));
+    while(mask != 0){
+      size_t at = i + __builtin_ctz(mask);
+      if(self->first[haystack[at]]) return at;
+      mask &= mask-1;
+    }
+  }
+  return signature_skip_scalar(self, haystack, end, i);
+}
+
+#endif
+
+typedef size_t (*SignatureSkipKernel)(SignatureSet* self, const uint8_t* haystack, size_t end, size_t i);
+
+static SignatureSkipKernel signature_skip = NULL;
+static const char* signature_kernel_label = "scalar";
+
+static void signature_resolve(void){
+  signature_skip = signature_skip_scalar;
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2")){
+    signature_skip = signature_skip_avx2;
+    signature_kernel_label = "avx2";
+  }else if(__builtin_cpu_supports("ssse3")){
+    signature_skip = signature_skip_ssse3;
+    signature_kernel_label = "ssse3";
+  }
+#endif
+}
+
+const char* signature_kernel_name(void){
+  if(signature_skip == NULL) signature_resolve();
+  return signature_kernel_label;
+}
+
+// reports the signatures ending right before i that start below limit
+static void SignatureSet_report(SignatureSet* self, uint32_t state, size_t i, size_t limit,
+    size_t base, SearchHits* hits){
+  uint32_t found = self->output[state] != SIGNATURE_NONE ? state : self->dict[state];
+  for(; found != SIGNATURE_NONE; found = self->dict[found]){
+    for(uint32_t k = self->output[found]; k != SIGNATURE_NONE; k = self->items[k].same){
+      size_t start = i - self->items[k].length;
+      if(start < limit) SearchHits_add(hits, base + start, self->items[k].length, k);
+    }
+  }
+}
+
+// runs the automaton from state at i until no match starting below limit is
+// possible anymore
+static void SignatureSet_run(SignatureSet* self, const uint8_t* haystack, size_t size, size_t limit,
+    size_t base, SearchHits* hits, size_t i, uint32_t state){
+  while(hits->count < SEARCH_MAX_HITS){
+    if(state == 0){
+      // the vector skip only pays off when the next byte is not a candidate
+      if(i >= limit) break;
+      if(!self->first[haystack[i]]) i = signature_skip(self, haystack, limit, i);
+      if(i >= limit) break;
+    }else if(i >= limit && (i - self->depth[state] >= limit || i >= size)){
+      // whatever matches from here on starts in the next chunk
+      break;
+    }
+    uint32_t next = self->next[state*256 + haystack[i]];
+    state = next & ~SIGNATURE_MATCH;
+    i++;
+    if(next & SIGNATURE_MATCH) SignatureSet_report(self, state, i, limit, base, hits);
+  }
+}
+
+void SignatureSet_scan(SignatureSet* self, const uint8_t* haystack, size_t size, size_t limit,
+    size_t base, SearchHits* hits){
+  if(self->states == 0) return;
+  if(signature_skip == NULL) signature_resolve();
+  if(limit > size) limit = size;
+
+  size_t candidates = 0;
+  for(size_t b = 0; b < 256; ++b) candidates += self->first[b];
+  if(candidates <= SIGNATURE_SKIP_CANDIDATES || limit < SIGNATURE_LANES*64){
+    SignatureSet_run(self, haystack, size, limit, base, hits, 0, 0);
+    return;
+  }
+
+  // most bytes start a signature, so the skip would not get far. The range
+  // is split into lanes stepped together instead, their table loads do not
+  // depend on each other and overlap
+  size_t at[SIGNATURE_LANES];
+  size_t end[SIGNATURE_LANES];
+  uint32_t state[SIGNATURE_LANES] = {0};
+  for(size_t k = 0; k < SIGNATURE_LANES; ++k){
+    at[k] = limit/SIGNATURE_LANES*k;
+    end[k] = k+1 == SIGNATURE_LANES ? limit : limit/SIGNATURE_LANES*(k+1);
+  }
+  size_t steps = limit/SIGNATURE_LANES;
+  for(size_t step = 0; step < steps && hits->count < SEARCH_MAX_HITS; ++step){
+    for(size_t k = 0; k < SIGNATURE_LANES; ++k){
+      uint32_t next = self->next[state[k]*256 + haystack[at[k]]];
+      state[k] = next & ~SIGNATURE_MATCH;
+      at[k]++;
+      if(next & SIGNATURE_MATCH) SignatureSet_report(self, state[k], at[k], end[k], base, hits);
+    }
+  }
+  // the last lane may be a little longer, and matches still in progress run
+  // on into the next lane
+  for(size_t k = 0; k < SIGNATURE_LANES; ++k){
+    SignatureSet_run(self, haystack, size, end[k], base, hits, at[k], state[k]);
+  }
+}
@@ -0,0 +1,66 @@
+#ifndef SIGNATURE_H_
+#define SIGNATURE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "search.h"
+
+#define SIGNATURE_NONE UINT32_MAX
+// set on transitions into states that signatures end in
+#define SIGNATURE_MATCH 0x80000000u
+
+// with more bytes than this starting signatures the scan steps through
+// SIGNATURE_LANES parts of the data at once instead of skipping ahead
+#define SIGNATURE_SKIP_CANDIDATES 32
+#define SIGNATURE_LANES 4
+
+typedef struct{
+  char* name;
+  uint8_t* bytes;
+  size_t length;
+  uint32_t same; // next signature ending in the same state, SIGNATURE_NONE at the end
+} Signature;
+
+// Aho-Corasick automaton over a list of exact byte signatures, so all of
+// them are found in a single pass. Transitions are a dense table with 256
+// entries per state, which is fine for the few thousand states hundreds of
+// magic numbers make
+struct SignatureSet{
+  Signature* items;
+  size_t count;
+  size_t capacity;
+
+  uint32_t* next;   // states*256 transitions, failures already folded in
+  uint32_t* output; // first signature ending in a state
+  uint32_t* dict;   // closest shorter suffix state some signature ends in
+  uint32_t* depth;
+  size_t states;
+  size_t longest;
+
+  // bytes signatures start with, as a table and as nibble buckets for the
+  // vector prefilter (which may let a few other bytes through)
+  bool first[256];
+  uint8_t low[16];
+  uint8_t high[16];
+};
+
+// adds a signature, SignatureSet_build must be called before scanning again
+void SignatureSet_add(SignatureSet* self, const char* name, const uint8_t* bytes, size_t length);
+void SignatureSet_build(SignatureSet* self);
+// reads a list of signatures, one "name: hex bytes" per line, empty lines
+// and lines starting with # are skipped
+bool SignatureSet_load(SignatureSet* self, const char* path);
+void SignatureSet_free(SignatureSet* self);
+
+// appends every signature that starts at base+i for i < limit in haystack.
+// Outside of a partial match the scan skips ahead to the next byte that can
+// start a signature a vector at a time. Hits come out in no particular order
+void SignatureSet_scan(SignatureSet* self, const uint8_t* haystack, size_t size, size_t limit,
+    size_t base, SearchHits* hits);
+
+// name of the prefilter kernel SignatureSet_scan dispatches to, for logging
+const char* signature_kernel_name(void);
+
+#endif // SIGNATURE_H_
@@ -0,0 +1,227 @@
+#include "nob.h"
+
+#include <math.h>
+
+#include "gather.h"
+#include "stats.h"
+
+// values are decoded and reduced in blocks that stay in the L1 cache
+#define STATS_BLOCK 1024
+
+void Stats_reset(Stats* self){
+  memset(self, 0, sizeof(*self));
+  self->min = INFINITY;
+  self->max = -INFINITY;
+}
+
+static uint64_t Stats_hash(uint64_t x){
+  // splitmix64 finalizer
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9llu;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebllu;
+  x ^= x >> 31;
+  return x;
+}
+
+// Chan et al. parallel update of the moments
+static void Stats_merge_moments(Stats* self, size_t count, double mean, double m2){
+  if(count == 0) return;
+  size_t total = self->count + count;
+  double delta = mean - self->mean;
+  self->mean += delta*count/total;
+  self->m2 += m2 + delta*delta*((double)self->count*count/total);
+  self->count = total;
+}
+
+void Stats_add(Stats* self, const double* values, size_t count){
+  size_t n = 0;
+  double sum = 0;
+  for(size_t i = 0; i < count; ++i){
+    double x = values[i];
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    uint64_t hash = Stats_hash(bits);
+    uint64_t rest = hash << STATS_HLL_BITS;
+    uint8_t rank = rest == 0 ? 64-STATS_HLL_BITS+1 : __builtin_clzll(rest)+1;
+    uint8_t* reg = &self->registers[hash >> (64-STATS_HLL_BITS)];
+    if(rank > *reg) *reg = rank;
+
+    if(!isfinite(x)) continue;
+    if(x < self->min) self->min = x;
+    if(x > self->max) self->max = x;
+    sum += x;
+    n++;
+  }
+  if(n == 0) return;
+
+  // two passes over the block keep the squared differences small
+  double mean = sum/n;
+  double m2 = 0;
+  for(size_t i = 0; i < count; ++i){
+    if(!isfinite(values[i])) continue;
+    double d = values[i] - mean;
+    m2 += d*d;
+  }
+  Stats_merge_moments(self, n, mean, m2);
+}
+
+void Stats_add_histogram(Stats* self, const double* values, size_t count){
+  if(!(self->high > self->low)) return;
+  double scale = STATS_HISTOGRAM_BINS/(self->high - self->low);
+  for(size_t i = 0; i < count; ++i){
+    double x = values[i];
+    if(!isfinite(x) || x < self->low || x > self->high) continue;
+    size_t bin = (x - self->low)*scale;
+    if(bin >= STATS_HISTOGRAM_BINS) bin = STATS_HISTOGRAM_BINS-1;
+    self->histogram[bin]++;
+  }
+}
+
+void Stats_merge(Stats* self, Stats* other){
+  if(other->min < self->min) self->min = other->min;
+  if(other->max > self->max) self->max = other->max;
+  Stats_merge_moments(self, other->count, other->mean, other->m2);
+  for(size_t i = 0; i < STATS_HISTOGRAM_BINS; ++i){
+    self->histogram[i] += other->histogram[i];
+  }
+  for(size_t i = 0; i < STATS_HLL_REGISTERS; ++i){
+    if(other->registers[i] > self->registers[i]) self->registers[i] = other->registers[i];
+  }
+}
+
+double Stats_stddev(Stats* self){
+  if(self->count < 2) return 0;
+  return sqrt(self->m2/(self->count-1));
+}
+
+double Stats_distinct(Stats* self){
+  double m = STATS_HLL_REGISTERS;
+  double sum = 0;
+  size_t zeros = 0;
+  for(size_t i = 0; i < STATS_HLL_REGISTERS; ++i){
+    sum += ldexp(1, -self->registers[i]);
+    if(self->registers[i] == 0) zeros++;
+  }
+  if(zeros == STATS_HLL_REGISTERS) return 0;
+  double alpha = 0.7213/(1 + 1.079/m);
+  double estimate = alpha*m*m/sum;
+  // small ranges are better served by linear counting
+  if(estimate <= 2.5*m && zeros > 0) estimate = m*log(m/zeros);
+  return estimate;
+}
+
+bool Stats_decode(TypeOp* op, const uint8_t* column, size_t count, double* values){
+  if(!TypeKind_is_primitive(op->kind)) return false;
+  if(count > 0) type_kinds[TypeKind_native(op->kind)].to_doubles(column, count, values);
+  return true;
+}
+
+static void StatsJob_run(Job* job, size_t chunk){
+  StatsJob* self = (StatsJob*)job;
+  size_t first = chunk*self->records_per_chunk;
+  size_t count = self->count - first;
+  if(count > self->records_per_chunk) count = self->records_per_chunk;
+
+  Stats local;
+  Stats_reset(&local);
+  pthread_mutex_lock(&self->lock);
+  local.low = self->result.low;
+  local.high = self->result.high;
+  pthread_mutex_unlock(&self->lock);
+
+  size_t offset = self->base + first*self->stride + self->op.offset;
+  size_t span = (count-1)*self->stride + self->op.length;
+  uint8_t* buffer = NULL;
+  if(self->source->kind != DataSource_MMAP){
+    buffer = malloc(span);
+    if(buffer == NULL) return;
+  }
+  size_t got = 0;
+  const uint8_t* bytes = DataSource_scan(self->source, offset, span, buffer, &got);
+  if(got < span) count = got < self->op.length ? 0 : (got - self->op.length)/self->stride + 1;
+
+  uint8_t column[STATS_BLOCK*sizeof(double)];
+  double values[STATS_BLOCK];
+  for(size_t i = 0; i < count && !Job_is_cancelled(job); i += STATS_BLOCK){
+    size_t n = count - i < STATS_BLOCK ? count - i : STATS_BLOCK;
+    gather_op(&self->op, column, bytes + i*self->stride, self->stride, n);
+    Stats_decode(&self->op, column, n, values);
+    if(self->pass == 1) Stats_add(&local, values, n);
+    else Stats_add_histogram(&local, values, n);
+  }
+  free(buffer);
+
+  pthread_mutex_lock(&self->lock);
+  Stats_merge(&self->result, &local);
+  pthread_mutex_unlock(&self->lock);
+}
+
+void StatsJob_init(StatsJob* self){
+  memset(self, 0, sizeof(*self));
+  pthread_mutex_init(&self->lock, NULL);
+  Stats_reset(&self->result);
+}
+
+void StatsJob_destroy(StatsJob* self, ThreadPool* pool){
+  StatsJob_cancel(self, pool);
+  pthread_mutex_destroy(&self->lock);
+}
+
+void StatsJob_start(StatsJob* self, ThreadPool* pool, DataSource* source, TypeOp* op,
+    size_t base, size_t stride, size_t count){
+  StatsJob_cancel(self, pool);
+  Stats_reset(&self->result);
+
+  // decoding nothing tells whether op is a number at all
+  if(!Stats_decode(op, NULL, 0, NULL) || gather_field_size(op) > sizeof(double) || count == 0 || stride == 0){
+    return;
+  }
+  // resolved here so the workers never race on it
+  gather_kernel_name();
+
+  self->source = source;
+  self->op = *op;
+  self->base = base;
+  self->stride = stride;
+  self->count = count;
+  self->records_per_chunk = STATS_CHUNK_SIZE/stride;
+  if(self->records_per_chunk == 0) self->records_per_chunk = 1;
+  self->pass = 1;
+  self->running = true;
+  self->job.run = StatsJob_run;
+  self->job.chunks = (count + self->records_per_chunk-1)/self->records_per_chunk;
+  ThreadPool_submit(pool, &self->job);
+}
+
+void StatsJob_cancel(StatsJob* self, ThreadPool* pool){
+  Job_cancel(pool, &self->job);
+  self->running = false;
+}
+
+void StatsJob_update(StatsJob* self, ThreadPool* pool){
+  if(!self->running || !Job_is_done(&self->job)) return;
+  if(self->pass == 2 || Job_is_cancelled(&self->job)){
+    self->running = false;
+    return;
+  }
+
+  self->pass = 2;
+  pthread_mutex_lock(&self->lock);
+  self->result.low = self->result.min;
+  self->result.high = self->result.max;
+  bool ranged = self->result.high > self->result.low;
+  pthread_mutex_unlock(&self->lock);
+  if(!ranged){
+    // a single value, there is nothing to bin
+    self->running = false;
+    return;
+  }
+  ThreadPool_submit(pool, &self->job);
+}
+
+void StatsJob_result(StatsJob* self, Stats* result){
+  pthread_mutex_lock(&self->lock);
+  *result = self->result;
+  pthread_mutex_unlock(&self->lock);
+}
@@ -0,0 +1,84 @@
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "data_source.h"
+#include "thread_pool.h"
+#include "type.h"
+
+#define STATS_HISTOGRAM_BINS 64
+
+// 2^STATS_HLL_BITS HyperLogLog registers, about 1.6% error
+#define STATS_HLL_BITS 12
+#define STATS_HLL_REGISTERS (1 << STATS_HLL_BITS)
+
+// bytes of records every chunk of a StatsJob covers
+#ifndef STATS_CHUNK_SIZE
+#define STATS_CHUNK_SIZE (4*1024*1024)
+#endif // STATS_CHUNK_SIZE
+
+// summary of the values of a field, values that are not finite only count
+// towards the distinct estimate
+typedef struct{
+  size_t count;
+  double min;
+  double max;
+  double mean;
+  double m2; // sum of squared differences from the mean
+  // histogram over [low, high], only filled when high > low
+  double low;
+  double high;
+  size_t histogram[STATS_HISTOGRAM_BINS];
+  uint8_t registers[STATS_HLL_REGISTERS];
+} Stats;
+
+void Stats_reset(Stats* self);
+void Stats_add(Stats* self, const double* values, size_t count);
+void Stats_add_histogram(Stats* self, const double* values, size_t count);
+// combines the summary of disjoint values into self
+void Stats_merge(Stats* self, Stats* other);
+
+double Stats_stddev(Stats* self);
+// HyperLogLog estimate of the number of distinct values
+double Stats_distinct(Stats* self);
+
+// decodes count values of the kind of op laid out one after another in host
+// byte order (as gather_field leaves them), returns false when op is not a
+// number
+bool Stats_decode(TypeOp* op, const uint8_t* column, size_t count, double* values);
+
+// computes the Stats of a field over every record of an array on a pool,
+// first the moments and distinct count, then the histogram once the range is
+// known. Chunks are merged into the result as soon as they finish
+typedef struct{
+  Job job;
+  DataSource* source;
+  TypeOp op;
+  size_t base;
+  size_t stride;
+  size_t count;
+  size_t records_per_chunk;
+  size_t pass;  // 1 for the moments, 2 for the histogram
+  bool running;
+
+  pthread_mutex_t lock; // guards result
+  Stats result;
+} StatsJob;
+
+void StatsJob_init(StatsJob* self);
+void StatsJob_destroy(StatsJob* self, ThreadPool* pool);
+
+// starts over for field op of count records of stride bytes at base
+void StatsJob_start(StatsJob* self, ThreadPool* pool, DataSource* source, TypeOp* op,
+    size_t base, size_t stride, size_t count);
+void StatsJob_cancel(StatsJob* self, ThreadPool* pool);
+// starts the next pass when the current one is done, call once a frame
+void StatsJob_update(StatsJob* self, ThreadPool* pool);
+// copy of what was merged so far
+void StatsJob_result(StatsJob* self, Stats* result);
+
+#endif // STATS_H_
@@ -0,0 +1,156 @@
+#include "nob.h"
+
+#include <unistd.h>
+
+#include "thread_pool.h"
+
+// drops the chunks of job that were not handed out yet, the lock must be held
+static void ThreadPool_dequeue(ThreadPool* self, Job* job){
+  if(!job->queued) return;
+  for(size_t i = 0; i < self->queue.count; ++i){
+    if(self->queue.items[i] != job) continue;
+    memmove(&self->queue.items[i], &self->queue.items[i+1],
+        (self->queue.count-i-1)*sizeof(*self->queue.items));
+    self->queue.count--;
+    break;
+  }
+  atomic_fetch_add(&job->finished, job->chunks - job->next);
+  job->next = job->chunks;
+  job->queued = false;
+  pthread_cond_broadcast(&self->done);
+}
+
+static void* ThreadPool_run(void* arg){
+  ThreadPool* self = arg;
+
+  pthread_mutex_lock(&self->lock);
+  for(;;){
+    while(self->running && self->queue.count == 0){
+      pthread_cond_wait(&self->wake, &self->lock);
+    }
+    if(!self->running) break;
+
+    Job* job = self->queue.items[0];
+    size_t chunk = job->next++;
+    if(job->next == job->chunks){
+      // last chunk handed out, the job leaves the queue
+      job->queued = false;
+      memmove(&self->queue.items[0], &self->queue.items[1],
+          (self->queue.count-1)*sizeof(*self->queue.items));
+      self->queue.count--;
+    }
+    pthread_mutex_unlock(&self->lock);
+
+    if(!atomic_load(&job->cancelled)) job->run(job, chunk);
+
+    pthread_mutex_lock(&self->lock);
+    atomic_fetch_add(&job->finished, 1);
+    pthread_cond_broadcast(&self->done);
+  }
+  pthread_mutex_unlock(&self->lock);
+  return NULL;
+}
+
+bool ThreadPool_start(ThreadPool* self, size_t count){
+  if(self->running) return true;
+  if(count == 0){
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    count = cores > 1 ? cores-1 : 1;
+  }
+
+  *self = (ThreadPool){
+    .threads = calloc(count, sizeof(*self->threads)),
+    .running = true,
+  };
+  if(self->threads == NULL){
+    nob_log(NOB_ERROR, "ThreadPool_start: could not allocate %zu threads", count);
+    return false;
+  }
+  pthread_mutex_init(&self->lock, NULL);
+  pthread_cond_init(&self->wake, NULL);
+  pthread_cond_init(&self->done, NULL);
+
+  for(size_t i = 0; i < count; ++i){
+    int err = pthread_create(&self->threads[i], NULL, ThreadPool_run, self);
+    if(err != 0){
+      nob_log(NOB_ERROR, "ThreadPool_start: could not start worker: %s", strerror(err));
+      break;
+    }
+    self->count++;
+  }
+  if(self->count == 0){
+    ThreadPool_stop(self);
+    return false;
+  }
+  nob_log(NOB_INFO, "ThreadPool_start: %zu workers", self->count);
+  return true;
+}
+
+void ThreadPool_stop(ThreadPool* self){
+  if(!self->running) return;
+
+  pthread_mutex_lock(&self->lock);
+  self->running = false;
+  while(self->queue.count > 0) ThreadPool_dequeue(self, self->queue.items[0]);
+  pthread_cond_broadcast(&self->wake);
+  pthread_mutex_unlock(&self->lock);
+
+  for(size_t i = 0; i < self->count; ++i){
+    pthread_join(self->threads[i], NULL);
+  }
+  pthread_mutex_destroy(&self->lock);
+  pthread_cond_destroy(&self->wake);
+  pthread_cond_destroy(&self->done);
+  free(self->threads);
+  nob_da_free(self->queue);
+  *self = (ThreadPool){0};
+}
+
+void ThreadPool_submit(ThreadPool* self, Job* job){
+  atomic_store(&job->finished, 0);
+  atomic_store(&job->cancelled, false);
+  if(job->chunks == 0) return;
+
+  pthread_mutex_lock(&self->lock);
+  job->next = 0;
+  job->queued = true;
+  nob_da_append(&self->queue, job);
+  pthread_cond_broadcast(&self->wake);
+  pthread_mutex_unlock(&self->lock);
+}
+
+void Job_cancel(ThreadPool* pool, Job* job){
+  atomic_store(&job->cancelled, true);
+  Job_wait(pool, job);
+}
+
+void Job_wait(ThreadPool* pool, Job* job){
+  if(!pool->running){
+    // a stopped pool already dropped everything it did not run
+    return;
+  }
+  pthread_mutex_lock(&pool->lock);
+  if(!job->queued && job->next < job->chunks){
+    // never submitted
+    pthread_mutex_unlock(&pool->lock);
+    return;
+  }
+  if(atomic_load(&job->cancelled)) ThreadPool_dequeue(pool, job);
+  while(atomic_load(&job->finished) < job->chunks){
+    pthread_cond_wait(&pool->done, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+bool Job_is_cancelled(Job* self){
+  return atomic_load(&self->cancelled);
+}
+
+bool Job_is_done(Job* self){
+  return atomic_load(&self->finished) >= self->chunks;
+}
+
+float Job_progress(Job* self){
+  if(self->chunks == 0) return 1;
+  return (float)atomic_load(&self->finished)/self->chunks;
+}
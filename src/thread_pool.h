@@ -0,0 +1,61 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+typedef struct Job Job;
+
+// work split into chunks that the workers of a pool pick up in order, a job
+// is usually the first member of a bigger struct that run casts back to.
+// The job must stay alive until Job_wait or Job_cancel returned
+struct Job{
+  void (*run)(Job* self, size_t chunk);
+  size_t chunks;
+
+  // guarded by the pool lock
+  size_t next;
+  bool queued;
+
+  atomic_size_t finished;
+  atomic_bool cancelled;
+};
+
+typedef struct{
+  pthread_t* threads;
+  size_t count;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_cond_t done;
+  bool running;
+
+  // jobs with chunks that were not handed out yet, oldest first
+  struct{
+    Job** items;
+    size_t count;
+    size_t capacity;
+  } queue;
+} ThreadPool;
+
+// starts count workers, 0 uses all but one of the cores
+bool ThreadPool_start(ThreadPool* self, size_t count);
+// stops the workers once their current chunk is done, chunks of queued jobs
+// that were not handed out yet are dropped and count as finished
+void ThreadPool_stop(ThreadPool* self);
+
+// resets job and queues all of its chunks, self must be running
+void ThreadPool_submit(ThreadPool* self, Job* job);
+
+// drops the chunks of job that were not handed out yet and waits for the ones
+// that are still running
+void Job_cancel(ThreadPool* pool, Job* job);
+void Job_wait(ThreadPool* pool, Job* job);
+
+bool Job_is_cancelled(Job* self);
+bool Job_is_done(Job* self);
+// fraction of the chunks that are finished
+float Job_progress(Job* self);
+
+#endif // THREAD_POOL_H_
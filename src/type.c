@@ -0,0 +1,478 @@
+#include "nob.h"
+
+#include <math.h>
+
+#include "type.h"
+#include "varint.h"
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define TYPE_HOST_BIG_ENDIAN true
+#else
+#define TYPE_HOST_BIG_ENDIAN false
+#endif
+
+static uint64_t load_8(const uint8_t* value){
+  return value[0];
+}
+
+#define TYPE_LOAD(bits) \
+  static uint64_t load_le##bits(const uint8_t* value){ \
+    uint##bits##_t x; \
+    memcpy(&x, value, sizeof(x)); \
+    return TYPE_HOST_BIG_ENDIAN ? __builtin_bswap##bits(x) : x; \
+  } \
+  static uint64_t load_be##bits(const uint8_t* value){ \
+    uint##bits##_t x; \
+    memcpy(&x, value, sizeof(x)); \
+    return TYPE_HOST_BIG_ENDIAN ? x : __builtin_bswap##bits(x); \
+  }
+TYPE_LOAD(16)
+TYPE_LOAD(32)
+TYPE_LOAD(64)
+
+// name##_to_double and name##_format take the bits of the value,
+// name##_to_doubles a column of values in host byte order
+#define TYPE_INTEGER(name, type, fmt, cast) \
+  static double name##_to_double(uint64_t bits){ return (type)bits; } \
+  static const char* name##_format(uint64_t bits){ return nob_temp_sprintf(fmt, (cast)(type)bits); } \
+  static void name##_to_doubles(const uint8_t* column, size_t count, double* values){ \
+    for(size_t i = 0; i < count; ++i){ \
+      type x; \
+      memcpy(&x, column + i*sizeof(x), sizeof(x)); \
+      values[i] = x; \
+    } \
+  }
+TYPE_INTEGER(i8, int8_t, "%lld", long long)
+TYPE_INTEGER(u8, uint8_t, "%llu", unsigned long long)
+TYPE_INTEGER(i16, int16_t, "%lld", long long)
+TYPE_INTEGER(u16, uint16_t, "%llu", unsigned long long)
+TYPE_INTEGER(i32, int32_t, "%lld", long long)
+TYPE_INTEGER(u32, uint32_t, "%llu", unsigned long long)
+TYPE_INTEGER(i64, int64_t, "%lld", long long)
+TYPE_INTEGER(u64, uint64_t, "%llu", unsigned long long)
+
+static float f16_to_float(uint16_t h){
+  float sign = (h & 0x8000) ? -1 : 1;
+  int exponent = (h >> 10) & 0x1F;
+  int mantissa = h & 0x3FF;
+  if(exponent == 0) return sign*ldexpf(mantissa, -24);
+  if(exponent == 31) return mantissa == 0 ? sign*INFINITY : NAN;
+  return sign*ldexpf(mantissa | 0x400, exponent-25);
+}
+
+static double f16_to_double(uint64_t bits){
+  return f16_to_float(bits);
+}
+
+static double f32_to_double(uint64_t bits){
+  uint32_t x = bits;
+  float f;
+  memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+static double f64_to_double(uint64_t bits){
+  double f;
+  memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+static const char* f16_format(uint64_t bits){ return nob_temp_sprintf("%g", f16_to_double(bits)); }
+static const char* f32_format(uint64_t bits){ return nob_temp_sprintf("%g", f32_to_double(bits)); }
+static const char* f64_format(uint64_t bits){ return nob_temp_sprintf("%g", f64_to_double(bits)); }
+
+static void f16_to_doubles(const uint8_t* column, size_t count, double* values){
+  for(size_t i = 0; i < count; ++i){
+    uint16_t x;
+    memcpy(&x, column + i*sizeof(x), sizeof(x));
+    values[i] = f16_to_float(x);
+  }
+}
+
+static void f32_to_doubles(const uint8_t* column, size_t count, double* values){
+  for(size_t i = 0; i < count; ++i){
+    float x;
+    memcpy(&x, column + i*sizeof(x), sizeof(x));
+    values[i] = x;
+  }
+}
+
+static void f64_to_doubles(const uint8_t* column, size_t count, double* values){
+  memcpy(values, column, count*sizeof(*values));
+}
+
+#define TYPE_PRIMITIVE(kind_name, text, bits, klass, be, other, fn) \
+  [kind_name] = { \
+    .name = text, \
+    .size = bits/8, \
+    .align = bits/8, \
+    .class = klass, \
+    .big_endian = be, \
+    .swap = bits > 8 && be != TYPE_HOST_BIG_ENDIAN, \
+    .sibling = other, \
+    .load = bits == 8 ? load_8 : bits == 16 ? (be ? load_be16 : load_le16) \
+      : bits == 32 ? (be ? load_be32 : load_le32) : (be ? load_be64 : load_le64), \
+    .to_double = fn##_to_double, \
+    .format = fn##_format, \
+    .to_doubles = bits == 8 || be == TYPE_HOST_BIG_ENDIAN ? fn##_to_doubles : NULL, \
+  }
+
+const TypeKindInfo type_kinds[Type_KIND_COUNT] = {
+  [Type_STRUCT] = { .name = "Struct" },
+  [Type_CHAR_ARRAY] = { .name = "Char", .align = 1 },
+  TYPE_PRIMITIVE(Type_I8,  "i8",  8,  TypeClass_SIGNED,   false, Type_I8,  i8),
+  TYPE_PRIMITIVE(Type_U8,  "u8",  8,  TypeClass_UNSIGNED, false, Type_U8,  u8),
+  TYPE_PRIMITIVE(Type_I16, "i16", 16, TypeClass_SIGNED,   false, Type_I16_BE, i16),
+  TYPE_PRIMITIVE(Type_U16, "u16", 16, TypeClass_UNSIGNED, false, Type_U16_BE, u16),
+  TYPE_PRIMITIVE(Type_I32, "i32", 32, TypeClass_SIGNED,   false, Type_I32_BE, i32),
+  TYPE_PRIMITIVE(Type_U32, "u32", 32, TypeClass_UNSIGNED, false, Type_U32_BE, u32),
+  TYPE_PRIMITIVE(Type_I64, "i64", 64, TypeClass_SIGNED,   false, Type_I64_BE, i64),
+  TYPE_PRIMITIVE(Type_U64, "u64", 64, TypeClass_UNSIGNED, false, Type_U64_BE, u64),
+  TYPE_PRIMITIVE(Type_F16, "f16", 16, TypeClass_FLOAT,    false, Type_F16_BE, f16),
+  TYPE_PRIMITIVE(Type_F32, "f32", 32, TypeClass_FLOAT,    false, Type_F32_BE, f32),
+  TYPE_PRIMITIVE(Type_F64, "f64", 64, TypeClass_FLOAT,    false, Type_F64_BE, f64),
+  TYPE_PRIMITIVE(Type_I16_BE, "i16be", 16, TypeClass_SIGNED,   true, Type_I16, i16),
+  TYPE_PRIMITIVE(Type_U16_BE, "u16be", 16, TypeClass_UNSIGNED, true, Type_U16, u16),
+  TYPE_PRIMITIVE(Type_I32_BE, "i32be", 32, TypeClass_SIGNED,   true, Type_I32, i32),
+  TYPE_PRIMITIVE(Type_U32_BE, "u32be", 32, TypeClass_UNSIGNED, true, Type_U32, u32),
+  TYPE_PRIMITIVE(Type_I64_BE, "i64be", 64, TypeClass_SIGNED,   true, Type_I64, i64),
+  TYPE_PRIMITIVE(Type_U64_BE, "u64be", 64, TypeClass_UNSIGNED, true, Type_U64, u64),
+  TYPE_PRIMITIVE(Type_F16_BE, "f16be", 16, TypeClass_FLOAT,    true, Type_F16, f16),
+  TYPE_PRIMITIVE(Type_F32_BE, "f32be", 32, TypeClass_FLOAT,    true, Type_F32, f32),
+  TYPE_PRIMITIVE(Type_F64_BE, "f64be", 64, TypeClass_FLOAT,    true, Type_F64, f64),
+  // decoded bitfields are u64 in host byte order
+  [Type_BITS] = {
+    .name = "Bits",
+    .align = 1,
+    .class = TypeClass_UNSIGNED,
+    .big_endian = TYPE_HOST_BIG_ENDIAN,
+    .sibling = Type_BITS,
+    .load = TYPE_HOST_BIG_ENDIAN ? load_be64 : load_le64,
+    .to_double = u64_to_double,
+    .format = u64_format,
+    .to_doubles = u64_to_doubles,
+  },
+  // decoded varints are u64 and i64 in host byte order
+  [Type_VARINT] = {
+    .name = "varint",
+    .align = 1,
+    .class = TypeClass_UNSIGNED,
+    .dynamic = true,
+    .big_endian = TYPE_HOST_BIG_ENDIAN,
+    .sibling = Type_VARINT,
+    .load = TYPE_HOST_BIG_ENDIAN ? load_be64 : load_le64,
+    .to_double = u64_to_double,
+    .format = u64_format,
+    .to_doubles = u64_to_doubles,
+  },
+  [Type_SVARINT] = {
+    .name = "svarint",
+    .align = 1,
+    .class = TypeClass_SIGNED,
+    .dynamic = true,
+    .big_endian = TYPE_HOST_BIG_ENDIAN,
+    .sibling = Type_SVARINT,
+    .load = TYPE_HOST_BIG_ENDIAN ? load_be64 : load_le64,
+    .to_double = i64_to_double,
+    .format = i64_format,
+    .to_doubles = i64_to_doubles,
+  },
+  [Type_BLOB] = { .name = "Blob", .align = 1, .dynamic = true, .sibling = Type_BLOB },
+};
+
+bool TypeKind_is_primitive(TypeKind kind){
+  return type_kinds[kind].class != TypeClass_NONE;
+}
+
+TypeKind TypeKind_native(TypeKind kind){
+  return type_kinds[kind].swap ? type_kinds[kind].sibling : kind;
+}
+
+TypeKind TypeKind_with_order(TypeKind kind, bool big_endian){
+  if(!TypeKind_is_primitive(kind) || type_kinds[kind].big_endian == big_endian) return kind;
+  return type_kinds[kind].sibling;
+}
+
+#define TYPE_POOL_PAGE_SIZE 256
+
+typedef struct{
+  Type** pages;
+  size_t page_count;
+  size_t count;   // nodes handed out so far, including freed ones
+  TypeId free;    // freed nodes linked through next
+} TypePool;
+
+static TypePool type_arena = {0};
+
+size_t type_edits = 0;
+
+Type* Type_get(TypeId id){
+  if(id == 0) return NULL;
+  return &type_arena.pages[id/TYPE_POOL_PAGE_SIZE][id%TYPE_POOL_PAGE_SIZE];
+}
+
+Type* Type_new(Type init){
+  TypeId id = type_arena.free;
+  if(id != 0){
+    type_arena.free = Type_get(id)->next;
+  }else{
+    // node 0 is reserved so that 0 can mean no node
+    if(type_arena.count == 0) type_arena.count = 1;
+    if(type_arena.count >= type_arena.page_count*TYPE_POOL_PAGE_SIZE){
+      type_arena.pages = realloc(type_arena.pages, (type_arena.page_count+1)*sizeof(*type_arena.pages));
+      NOB_ASSERT(type_arena.pages != NULL && "Buy more RAM lol");
+      type_arena.pages[type_arena.page_count] = malloc(TYPE_POOL_PAGE_SIZE*sizeof(Type));
+      NOB_ASSERT(type_arena.pages[type_arena.page_count] != NULL && "Buy more RAM lol");
+      type_arena.page_count++;
+    }
+    id = type_arena.count++;
+  }
+
+  Type* self = Type_get(id);
+  *self = init;
+  self->id = id;
+  self->parent = 0;
+  self->prev = 0;
+  self->next = 0;
+  self->dirty = true;
+  if(self->kind == Type_STRUCT) memset(&self->as, 0, sizeof(self->as));
+  return self;
+}
+
+void Type_free(Type* self){
+  if(self == NULL) return;
+  if(self->kind == Type_STRUCT){
+    Type* child = Type_first(self);
+    while(child != NULL){
+      Type* next = Type_next(child);
+      Type_free(child);
+      child = next;
+    }
+  }
+  memset(&self->as, 0, sizeof(self->as));
+  self->parent = 0;
+  self->prev = 0;
+  self->next = type_arena.free;
+  type_arena.free = self->id;
+}
+
+Type* Type_parent(Type* self){
+  return Type_get(self->parent);
+}
+
+Type* Type_first(Type* self){
+  if(self->kind != Type_STRUCT) return NULL;
+  return Type_get(self->as.Struct.first);
+}
+
+Type* Type_next(Type* self){
+  return Type_get(self->next);
+}
+
+Type* Struct_add(Type* self, Type child){
+  if(self->kind != Type_STRUCT) return NULL;
+  Type* added = Type_new(child);
+  added->parent = self->id;
+  added->prev = self->as.Struct.last;
+  if(self->as.Struct.last != 0){
+    Type_get(self->as.Struct.last)->next = added->id;
+  }else{
+    self->as.Struct.first = added->id;
+  }
+  self->as.Struct.last = added->id;
+  self->as.Struct.count++;
+  Type_invalidate(self);
+  return added;
+}
+
+void Struct_remove(Type* self, Type* child){
+  if(self->kind != Type_STRUCT || child->parent != self->id) return;
+  if(child->prev != 0) Type_get(child->prev)->next = child->next;
+  else self->as.Struct.first = child->next;
+  if(child->next != 0) Type_get(child->next)->prev = child->prev;
+  else self->as.Struct.last = child->prev;
+  self->as.Struct.count--;
+  Type_invalidate(self);
+  Type_free(child);
+}
+
+void Array_set_count(Type* self, size_t count){
+  if(self->kind != Type_CHAR_ARRAY || self->as.Array.count == count) return;
+  self->as.Array.count = count;
+  Type_invalidate(self);
+}
+
+void Bits_set_width(Type* self, size_t width){
+  if(width < 1) width = 1;
+  if(width > TYPE_BITS_MAX_WIDTH) width = TYPE_BITS_MAX_WIDTH;
+  if(self->kind != Type_BITS || self->as.Bits.width == width) return;
+  self->as.Bits.width = width;
+  Type_invalidate(self);
+}
+
+void Type_invalidate(Type* self){
+  type_edits++;
+  // a dirty node always has dirty parents, so the walk can stop early
+  for(; self != NULL && !self->dirty; self = Type_parent(self)){
+    self->dirty = true;
+  }
+}
+
+static void Type_update(Type* self){
+  switch (self->kind) {
+    default:{
+      // every dynamic kind starts with a varint, which takes at least a byte
+      self->size = type_kinds[self->kind].dynamic ? 1 : type_kinds[self->kind].size;
+    }break;
+    case Type_CHAR_ARRAY: self->size = self->as.Array.count; break;
+    case Type_BITS: self->size = (self->as.Bits.shift + self->as.Bits.width + 7)/8; break;
+    case Type_STRUCT:{
+      size_t size = 0;
+      // bits taken by the current run of bitfields, which start at size
+      size_t bits = 0;
+      for(Type* child = Type_first(self); child != NULL; child = Type_next(child)){
+        if(child->kind == Type_BITS){
+          child->offset = size + bits/8;
+          child->as.Bits.shift = bits%8;
+          Type_update(child);
+          bits += child->as.Bits.width;
+          continue;
+        }
+        size += (bits+7)/8;
+        bits = 0;
+        child->offset = size;
+        size += Type_sizeof(child);
+      }
+      self->size = size + (bits+7)/8;
+    }break;
+  }
+  self->dirty = false;
+}
+
+size_t Type_sizeof(Type* self){
+  if(self->dirty) Type_update(self);
+  return self->size;
+}
+
+size_t Type_offsetof(Type* self){
+  Type* parent = Type_parent(self);
+  if(parent == NULL) return 0;
+  if(parent->dirty) Type_update(parent);
+  return self->offset;
+}
+
+static size_t TypeProgram_emit(TypeProgram* self, Type* type, size_t offset){
+  switch(type->kind){
+    case Type_STRUCT:{
+      for(Type* child = Type_first(type); child != NULL; child = Type_next(child)){
+        TypeProgram_emit(self, child, offset+Type_offsetof(child));
+      }
+      return Type_sizeof(type);
+    }
+    default:{
+      TypeOp op = {
+        .offset = offset,
+        .length = Type_sizeof(type),
+        .kind = type->kind,
+        .type = type,
+      };
+      if(type->kind == Type_BITS){
+        op.shift = type->as.Bits.shift;
+        op.width = type->as.Bits.width;
+      }
+      op.dynamic = type_kinds[type->kind].dynamic;
+      if(op.dynamic) self->dynamic++;
+      nob_da_append(self, op);
+      return op.length;
+    }
+  }
+  return 0;
+}
+
+void TypeProgram_compile(TypeProgram* self, Type* root){
+  self->count = 0;
+  self->dynamic = 0;
+  self->root = root;
+  self->type_edits = type_edits;
+  self->size = root == NULL ? 0 : TypeProgram_emit(self, root, 0);
+
+  // varints stored back to back are decoded together
+  for(size_t i = self->count; i-- > 0;){
+    TypeOp* op = &self->items[i];
+    if(op->kind != Type_VARINT && op->kind != Type_SVARINT) continue;
+    TypeOp* next = i+1 < self->count ? &self->items[i+1] : NULL;
+    bool joined = next != NULL && next->run > 0 && next->offset == op->offset + op->length;
+    op->run = joined ? next->run+1 : 1;
+  }
+}
+
+void TypeProgram_update(TypeProgram* self, Type* root){
+  if(self->root == root && self->type_edits == type_edits) return;
+  TypeProgram_compile(self, root);
+}
+
+void TypeProgram_free(TypeProgram* self){
+  nob_da_free(*self);
+  *self = (TypeProgram){0};
+}
+
+const char* TypeOp_name(TypeOp* op){
+  if(op->kind == Type_CHAR_ARRAY) return nob_temp_sprintf("Char[%zu]", op->length);
+  if(op->kind == Type_BITS) return nob_temp_sprintf("Bits[%zu]", op->width);
+  if(op->kind == Type_STRUCT) return "<undefined>";
+  return type_kinds[op->kind].name;
+}
+
+uint64_t TypeOp_bits(TypeOp* op, const uint8_t* value){
+  uint64_t word = 0;
+  for(size_t i = 0; i < op->length; ++i) word |= (uint64_t)value[i] << (i*8);
+  return (word >> op->shift) & (UINT64_MAX >> (64 - op->width));
+}
+
+const char* TypeOp_format_value(TypeOp* op, const uint8_t* buffer){
+  return TypeOp_format_raw(op, buffer + op->offset, op->length);
+}
+
+const char* TypeOp_format_raw(TypeOp* op, const uint8_t* value, size_t length){
+  switch(op->kind){
+    case Type_CHAR_ARRAY: return nob_temp_sprintf("%.*s", (int)op->length, (const char*)value);
+    case Type_BITS: return u64_format(TypeOp_bits(op, value));
+    case Type_VARINT:
+    case Type_SVARINT:{
+      uint64_t x;
+      if(varint_decode(value, length, &x) == 0) return "<truncated>";
+      return op->kind == Type_VARINT ? u64_format(x) : nob_temp_sprintf("%lld", (long long)varint_zigzag(x));
+    }
+    case Type_BLOB:{
+      uint64_t size;
+      size_t prefix = varint_decode(value, length, &size);
+      if(prefix == 0) return "<truncated>";
+      // a printable preview of what is at hand
+      size_t shown = length - prefix;
+      if(shown > size) shown = size;
+      if(shown > 32) shown = 32;
+      char* preview = nob_temp_alloc(shown+1);
+      for(size_t i = 0; i < shown; ++i){
+        uint8_t c = value[prefix+i];
+        preview[i] = c >= 32 && c < 127 ? c : '.';
+      }
+      preview[shown] = '\0';
+      return nob_temp_sprintf("[%llu] %s%s", (unsigned long long)size, preview, shown < size ? "..." : "");
+    }
+    default: break;
+  }
+  if(!TypeKind_is_primitive(op->kind)) return "<undefined>";
+  const TypeKindInfo* info = &type_kinds[op->kind];
+  return info->format(info->load(value));
+}
+
+const char* TypeOp_format_element(TypeOp* op, const uint8_t* value){
+  if(op->kind == Type_CHAR_ARRAY) return nob_temp_sprintf("%.*s", (int)op->length, (const char*)value);
+  if(!TypeKind_is_primitive(op->kind)) return "<undefined>";
+  const TypeKindInfo* info = &type_kinds[TypeKind_native(op->kind)];
+  return info->format(info->load(value));
+}
+
+const char* TypeOp_format(TypeOp* op, const uint8_t* buffer){
+  return nob_temp_sprintf("%s: %s", TypeOp_name(op), TypeOp_format_value(op, buffer));
+}
@@ -0,0 +1,187 @@
+#ifndef TYPE_H_
+#define TYPE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum{
+  Type_STRUCT = 0,
+  Type_CHAR_ARRAY,
+  // fixed width primitives, described by type_kinds
+  Type_I8,
+  Type_U8,
+  Type_I16,
+  Type_U16,
+  Type_I32,
+  Type_U32,
+  Type_I64,
+  Type_U64,
+  Type_F16,
+  Type_F32,
+  Type_F64,
+  Type_I16_BE,
+  Type_U16_BE,
+  Type_I32_BE,
+  Type_U32_BE,
+  Type_I64_BE,
+  Type_U64_BE,
+  Type_F16_BE,
+  Type_F32_BE,
+  Type_F64_BE,
+  // unsigned bitfield, consecutive bitfields of a struct share their bytes
+  Type_BITS,
+  // data dependent sizes, the size of the Type is the smallest encoding
+  Type_VARINT,   // unsigned LEB128
+  Type_SVARINT,  // zigzag LEB128
+  Type_BLOB,     // varint length followed by that many bytes
+  Type_KIND_COUNT,
+} TypeKind;
+
+typedef enum{
+  TypeClass_NONE = 0,
+  TypeClass_SIGNED,
+  TypeClass_UNSIGNED,
+  TypeClass_FLOAT,
+} TypeClass;
+
+// how to decode and print a kind, values travel as the bits of the value in
+// host byte order zero extended to 64 bits
+typedef struct{
+  const char* name;
+  size_t size;       // 0 when the size is not fixed
+  size_t align;
+  TypeClass class;
+  bool dynamic;      // the encoded size depends on the data
+  bool big_endian;
+  bool swap;         // stored in the opposite of the host byte order
+  TypeKind sibling;  // same kind in the other byte order
+  // reads a value stored in the byte order of the kind
+  uint64_t (*load)(const uint8_t* value);
+  double (*to_double)(uint64_t bits);
+  const char* (*format)(uint64_t bits);
+  // converts count values in host byte order laid out one after another,
+  // only set for the kinds in host byte order
+  void (*to_doubles)(const uint8_t* column, size_t count, double* values);
+} TypeKindInfo;
+
+extern const TypeKindInfo type_kinds[Type_KIND_COUNT];
+
+bool TypeKind_is_primitive(TypeKind kind);
+// the kind that reads the same values in host byte order
+TypeKind TypeKind_native(TypeKind kind);
+// kind in the given byte order
+TypeKind TypeKind_with_order(TypeKind kind, bool big_endian);
+
+// handle of a Type in the pool, 0 is never a valid node
+typedef uint32_t TypeId;
+
+typedef struct Type Type;
+struct Type{
+  TypeKind kind;
+  TypeId id;
+  TypeId parent;
+  // siblings within the parent struct
+  TypeId prev;
+  TypeId next;
+  // offset within the parent struct, valid when the parent is not dirty
+  size_t offset;
+  // cached Type_sizeof, only recomputed when dirty
+  size_t size;
+  bool dirty;
+  union{
+    struct{
+      TypeId first;
+      TypeId last;
+      size_t count;
+    } Struct;
+    struct{
+      size_t count;
+    } Array;
+    struct{
+      size_t shift; // first bit within the byte at offset, set by the parent
+      size_t width;
+    } Bits;
+  } as;
+};
+
+// bumped on every edit of any Type, anything derived from a Type compares
+// against it to know when to rebuild
+extern size_t type_edits;
+
+// Types live in a pool of fixed pages, so neither handles nor pointers to a
+// Type are invalidated by allocating or freeing other Types
+Type* Type_new(Type init);
+// frees self and all of its children, self must not be in a struct anymore
+void Type_free(Type* self);
+Type* Type_get(TypeId id);
+Type* Type_parent(Type* self);
+Type* Type_first(Type* self);
+Type* Type_next(Type* self);
+
+// appends a copy of child to self and returns the added Type
+Type* Struct_add(Type* self, Type child);
+// unlinks child from self and frees it
+void Struct_remove(Type* self, Type* child);
+void Array_set_count(Type* self, size_t count);
+
+// a bitfield never spans more than 8 bytes, whatever bit it starts at
+#define TYPE_BITS_MAX_WIDTH 57
+void Bits_set_width(Type* self, size_t width);
+
+// marks self and every parent as dirty, must be called after any edit
+void Type_invalidate(Type* self);
+size_t Type_sizeof(Type* self);
+// offset of self within its parent struct
+size_t Type_offsetof(Type* self);
+
+// a single primitive field of a compiled Type
+typedef struct{
+  size_t offset;
+  size_t length;
+  // bitfields only, the value is the width bits starting at bit shift of the
+  // little endian number made of the length bytes at offset
+  size_t shift;
+  size_t width;
+  TypeKind kind;
+  bool dynamic;
+  // varints only, how many varints follow back to back starting with this one
+  size_t run;
+  Type* type; // leaf the op was compiled from
+} TypeOp;
+
+// a Type flattened into its primitive fields in offset order, so decoding
+// does not have to walk the tree (or recompute sizes) again
+typedef struct{
+  TypeOp* items;
+  size_t count;
+  size_t capacity;
+  size_t size;     // smallest size of an instance
+  size_t dynamic;  // ops whose size depends on the data
+  Type* root;
+  size_t type_edits;
+} TypeProgram;
+
+void TypeProgram_compile(TypeProgram* self, Type* root);
+// recompiles when root changed or was edited since the last compile
+void TypeProgram_update(TypeProgram* self, Type* root);
+void TypeProgram_free(TypeProgram* self);
+
+// name of the type of op, like "i32" or "Char[16]", in temporary memory
+const char* TypeOp_name(TypeOp* op);
+// formats the value of op found in buffer (which starts at the program root)
+// into temporary memory, TypeOp_format prefixes it with the name
+const char* TypeOp_format_value(TypeOp* op, const uint8_t* buffer);
+const char* TypeOp_format(TypeOp* op, const uint8_t* buffer);
+// value of a bitfield op found at value (which starts at op->offset)
+uint64_t TypeOp_bits(TypeOp* op, const uint8_t* value);
+
+// formats the value of op whose length bytes are found at value, which for
+// dynamic ops does not have to be the whole field
+const char* TypeOp_format_raw(TypeOp* op, const uint8_t* value, size_t length);
+
+// same as TypeOp_format_value for an element of a column made by
+// gather_field, which is already in host byte order
+const char* TypeOp_format_element(TypeOp* op, const uint8_t* value);
+
+#endif // TYPE_H_
@@ -0,0 +1,115 @@
+#include "nob.h"
+
+#include <immintrin.h>
+
+#include "varint.h"
+
+size_t varint_decode(const uint8_t* src, size_t size, uint64_t* value){
+  uint64_t result = 0;
+  for(size_t i = 0; i < size && i < VARINT_MAX_BYTES; ++i){
+    result |= (uint64_t)(src[i] & 0x7F) << (i*7);
+    if((src[i] & 0x80) == 0){
+      *value = result;
+      return i+1;
+    }
+  }
+  return 0;
+}
+
+size_t varint_encode(uint64_t value, uint8_t* dst){
+  size_t length = 0;
+  while(value >= 0x80){
+    dst[length++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  dst[length++] = value;
+  return length;
+}
+
+int64_t varint_zigzag(uint64_t value){
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static size_t varint_decode_run_scalar(const uint8_t* src, size_t size, uint64_t* values, size_t count, size_t* used){
+  size_t done = 0;
+  size_t at = 0;
+  while(done < count){
+    size_t length = varint_decode(src + at, size - at, &values[done]);
+    if(length == 0) break;
+    at += length;
+    done++;
+  }
+  *used = at;
+  return done;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("bmi2")))
+static size_t varint_decode_run_bmi2(const uint8_t* src, size_t size, uint64_t* values, size_t count, size_t* used){
+  size_t done = 0;
+  size_t at = 0;
+  // a block is only taken apart when the 8 byte loads of its varints stay
+  // inside src, the rest is left to the scalar decoder
+  while(done < count && at + 24 <= size){
+    __m128i block = _mm_loadu_si128((const __m128i*)(src + at));
+    // bytes without the continuation bit end a varint
+    uint32_t ends = ~_mm_movemask_epi8(block) & 0xFFFF;
+    if(ends == 0) break;
+
+    size_t start = 0;
+    while(ends != 0 && done < count){
+      size_t end = __builtin_ctz(ends);
+      size_t length = end - start + 1;
+      if(length > 8){
+        // malformed, the scalar decoder picks up from this varint on
+        if(varint_decode(src + at + start, size - at - start, &values[done]) != length){
+          at += start;
+          goto finish;
+        }
+      }else{
+        uint64_t word;
+        memcpy(&word, src + at + start, sizeof(word));
+        values[done] = _pext_u64(word, 0x7F7F7F7F7F7F7F7Fllu >> (64 - 8*length));
+      }
+      done++;
+      start = end+1;
+      ends &= ends-1;
+    }
+    at += start;
+  }
+
+finish:;
+  size_t rest = 0;
+  done += varint_decode_run_scalar(src + at, size - at, values + done, count - done, &rest);
+  *used = at + rest;
+  return done;
+}
+
+#endif
+
+typedef size_t (*VarintRunKernel)(const uint8_t* src, size_t size, uint64_t* values, size_t count, size_t* used);
+
+static VarintRunKernel varint_run_kernel = NULL;
+static const char* varint_run_kernel_label = "scalar";
+
+static void varint_resolve(void){
+  varint_run_kernel = varint_decode_run_scalar;
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("bmi2")){
+    varint_run_kernel = varint_decode_run_bmi2;
+    varint_run_kernel_label = "bmi2";
+  }
+#endif
+}
+
+size_t varint_decode_run(const uint8_t* src, size_t size, uint64_t* values, size_t count, size_t* used){
+  if(varint_run_kernel == NULL) varint_resolve();
+  return varint_run_kernel(src, size, values, count, used);
+}
+
+const char* varint_kernel_name(void){
+  if(varint_run_kernel == NULL) varint_resolve();
+  return varint_run_kernel_label;
+}
@@ -0,0 +1,30 @@
+#ifndef VARINT_H_
+#define VARINT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// longest LEB128 encoding of a 64 bit value
+#define VARINT_MAX_BYTES 10
+
+// decodes the LEB128 varint at src, returns its length in bytes or 0 when it
+// is cut off by size or longer than VARINT_MAX_BYTES
+size_t varint_decode(const uint8_t* src, size_t size, uint64_t* value);
+
+// encodes value as LEB128 into dst, which has room for VARINT_MAX_BYTES, and
+// returns the length
+size_t varint_encode(uint64_t value, uint8_t* dst);
+
+// protobuf style zigzag mapping of unsigned varints onto signed values
+int64_t varint_zigzag(uint64_t value);
+
+// decodes up to count varints laid out back to back, returns how many were
+// decoded and stores the bytes they took in used. Terminators are found 16
+// bytes at a time and the payload bits pulled out with pext when available
+size_t varint_decode_run(const uint8_t* src, size_t size, uint64_t* values, size_t count, size_t* used);
+
+// name of the kernel varint_decode_run dispatches to, for logging
+const char* varint_kernel_name(void);
+
+#endif // VARINT_H_